@@ -0,0 +1,55 @@
+
+//
+// This is a GUI support code to the chapters 12-16 of the book
+// "Programming -- Principles and Practice Using C++" by Bjarne Stroustrup
+//
+
+// What the benchmark programs in this directory share.
+// Each one is a program of its own: build it from its .cpp file, the .cpp
+// files in ../GUI and the FLTK libraries, as Source.cpp is built, with
+// optimization on. They draw into an Offscreen, so no display is needed,
+// and print their timings to cout.
+
+#ifndef BENCH_GUARD
+#define BENCH_GUARD 1
+
+#include <chrono>
+#include <iostream>
+#include <random>
+
+namespace Bench {
+
+//------------------------------------------------------------------------------
+
+// the least time in milliseconds that f() takes in reps runs
+template<class F> double time_ms(F f, int reps = 5)
+{
+    double best = 0;
+    for (int i = 0; i<reps; ++i) {
+        std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+        f();
+        std::chrono::duration<double,std::milli> t = std::chrono::steady_clock::now()-t0;
+        if (i==0 || t.count()<best) best = t.count();
+    }
+    return best;
+}
+
+//------------------------------------------------------------------------------
+
+// the same numbers on every run, so that results can be compared
+inline std::mt19937& random_engine()
+{
+    static std::mt19937 e(12345);
+    return e;
+}
+
+inline int random_int(int lo, int hi)    // in [lo:hi]
+{
+    return std::uniform_int_distribution<int>(lo,hi)(random_engine());
+}
+
+//------------------------------------------------------------------------------
+
+} // of namespace Bench
+
+#endif // BENCH_GUARD
@@ -0,0 +1,56 @@
+
+//
+// This is a GUI support code to the chapters 12-16 of the book
+// "Programming -- Principles and Practice Using C++" by Bjarne Stroustrup
+//
+
+// Function sampled on the calling thread against sampled on a Thread_pool,
+// for an f that takes long, like a small simulation
+
+#include "Bench.h"
+#include "../GUI/Graph.h"
+#include "../GUI/Thread_pool.h"
+
+using namespace Graph_lib;
+
+//------------------------------------------------------------------------------
+
+double slow(double x)    // about 20 microseconds a call
+{
+    double s = 0;
+    for (int i = 1; i<=5000; ++i) s += sin(x*i)/i;
+    return s;
+}
+
+//------------------------------------------------------------------------------
+
+int main()
+{
+    const int count = 2000;
+    Thread_pool& pool = Thread_pool::shared();
+
+    bool same = true;
+    double serial = Bench::time_ms([&] {
+        Function f(slow,-5,5,Point(500,300),count,100,100);
+    },3);
+    double parallel = Bench::time_ms([&] {
+        Function f(slow,-5,5,Point(500,300),count,100,100,pool);
+    },3);
+
+    Function a(slow,-5,5,Point(500,300),count,100,100);
+    Function b(slow,-5,5,Point(500,300),count,100,100,pool);
+    if (a.number_of_points()!=b.number_of_points()) same = false;
+    for (int i = 0; same && i<a.number_of_points(); ++i)
+        if (a.point(i)!=b.point(i)) same = false;
+
+    cout << count << " samples of an expensive f:\n"
+         << "  serial:   " << serial << " ms\n"
+         << "  " << pool.size() << " workers: " << parallel << " ms\n"
+         << "  speedup: " << serial/parallel << '\n';
+    if (!same) {
+        cerr << "the two disagree\n";
+        return 1;
+    }
+}
+
+//------------------------------------------------------------------------------
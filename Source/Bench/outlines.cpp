@@ -0,0 +1,162 @@
+
+//
+// This is a GUI support code to the chapters 12-16 of the book
+// "Programming -- Principles and Practice Using C++" by Bjarne Stroustrup
+//
+
+// 50k Rounded_Rects and Circles drawn from their cached outlines against
+// the same shapes drawn as they were before, with fl_rectf(), fl_pie(),
+// fl_line() and fl_arc() on every frame: FLTK calls per shape and frame time
+
+#include "Bench.h"
+#include "../GUI/Offscreen.h"
+
+using namespace Graph_lib;
+using Bench::random_int;
+
+//------------------------------------------------------------------------------
+
+// Rounded_Rect::draw_lines() before the outline cache
+struct Old_rounded_rect : Shape {
+    Old_rounded_rect(Point xy, int w, int h)
+        : width(w), height(h), radius((w < h) ? w / 4 : h / 4) { add(xy); }
+
+    void draw_lines() const
+    {
+        const Point p = point(0);
+        const int r = radius;
+        if (fill_color().visibility()) {
+            Render_state::color(fill_color().as_int());
+            fl_rectf(p.x, p.y - height + r, r, height - r * 2);
+            fl_rectf(p.x + r, p.y - height, width - r * 2, height);
+            fl_rectf(p.x + width - r, p.y - height + r, r, height - r * 2);
+            fl_pie(p.x + width - r * 2, p.y - height, r * 2 - 1, r * 2 - 1, 0, 90);
+            fl_pie(p.x, p.y - height, r * 2 - 1, r * 2 - 1, 90, 180);
+            fl_pie(p.x, p.y - r * 2, r * 2 - 1, r * 2 - 1, 180, 270);
+            fl_pie(p.x + width - r * 2, p.y - r * 2, r * 2 - 1, r * 2 - 1, 270, 360);
+        }
+        if (color().visibility()) {
+            Render_state::color(color().as_int());
+            fl_line(p.x + r, p.y - height, p.x + width - r, p.y - height);
+            fl_line(p.x, p.y - r, p.x, p.y - height + r);
+            fl_line(p.x + width, p.y - r, p.x + width, p.y - height + r);
+            fl_line(p.x + r, p.y, p.x + width - r, p.y);
+            fl_arc(p.x + width - r * 2, p.y - height, r * 2, r * 2, 0, 90);
+            fl_arc(p.x, p.y - height, r * 2, r * 2, 90, 180);
+            fl_arc(p.x, p.y - r * 2, r * 2, r * 2, 180, 270);
+            fl_arc(p.x + width - r * 2, p.y - r * 2, r * 2, r * 2, 270, 360);
+        }
+    }
+    Bounds extent() const
+    {
+        const int d = line_pad();
+        return Bounds(point(0).x - d, point(0).y - height - d, width + 1 + d + d, height + 1 + d + d);
+    }
+private:
+    int width, height, radius;
+};
+
+//------------------------------------------------------------------------------
+
+// Circle::draw_lines() before the outline cache
+struct Old_circle : Shape {
+    Old_circle(Point p, int rr) : r(rr) { add(Point(p.x-r,p.y-r)); }
+
+    void draw_lines() const
+    {
+        if (color().visibility()) fl_arc(point(0).x,point(0).y,r+r,r+r,0,360);
+    }
+    Bounds extent() const
+    {
+        const int d = line_pad();
+        return Bounds(point(0).x-d,point(0).y-d,r+r+1+d+d,r+r+1+d+d);
+    }
+private:
+    int r;
+};
+
+//------------------------------------------------------------------------------
+
+// a Soft_driver that counts the drawing calls made to it
+class Counting_driver : public Soft_driver {
+public:
+    Counting_driver(Display_list& dl) : Soft_driver(dl), calls(0) { }
+    long calls;
+protected:
+    void rectf(int x, int y, int w, int h) { ++calls; Soft_driver::rectf(x,y,w,h); }
+    void line(int x, int y, int x1, int y1) { ++calls; Soft_driver::line(x,y,x1,y1); }
+    void arc(int x, int y, int w, int h, double a1, double a2)
+    { ++calls; Soft_driver::arc(x,y,w,h,a1,a2); }
+    void pie(int x, int y, int w, int h, double a1, double a2)
+    { ++calls; Soft_driver::pie(x,y,w,h,a1,a2); }
+    void begin_line() { ++calls; Soft_driver::begin_line(); }
+    void begin_loop() { ++calls; Soft_driver::begin_loop(); }
+    void begin_polygon() { ++calls; Soft_driver::begin_polygon(); }
+    void begin_complex_polygon() { ++calls; Soft_driver::begin_complex_polygon(); }
+};
+
+//------------------------------------------------------------------------------
+
+const int n = 50000;
+const int width = 1600;
+const int height = 1200;
+
+double calls_per_shape(const vector<Shape*>& v)
+{
+    Display_list dl;
+    Counting_driver d(dl);
+    Soft_surface s(&d);
+    Fl_Surface_Device* old = Fl_Surface_Device::surface();
+    s.set_current();
+    d.begin(width,height);
+    draw_all(v);
+    old->set_current();
+    return double(d.calls)/v.size();
+}
+
+double frame_ms(const vector<Shape*>& v)
+{
+    Offscreen out(width,height);
+    for (unsigned int i = 0; i<v.size(); ++i) out.attach(*v[i]);
+    out.draw();    // the outlines are made on the first draw
+    return Bench::time_ms([&] { out.draw(); },3);
+}
+
+void report(const string& name, const vector<Shape*>& v)
+{
+    cout << "  " << name << calls_per_shape(v) << " calls/shape, "
+         << frame_ms(v) << " ms/frame\n";
+}
+
+//------------------------------------------------------------------------------
+
+int main()
+{
+    vector<Shape*> rects, old_rects, circles, old_circles;
+    for (int i = 0; i<n; ++i) {
+        Point p(random_int(0,width),random_int(0,height));
+        int w = random_int(8,40), h = random_int(8,40), r = random_int(3,20);
+        rects.push_back(new Rounded_Rect(p,w,h));
+        rects.back()->set_fill_color(Color::yellow);
+        old_rects.push_back(new Old_rounded_rect(p,w,h));
+        old_rects.back()->set_fill_color(Color::yellow);
+        circles.push_back(new Circle(p,r));
+        old_circles.push_back(new Old_circle(p,r));
+    }
+
+    cout << n << " filled and outlined rounded rectangles:\n";
+    report("cached outline: ",rects);
+    report("arcs and pies:  ",old_rects);
+    cout << n << " circles:\n";
+    report("cached outline: ",circles);
+    report("fl_arc:         ",old_circles);
+
+    for (int i = 0; i<n; ++i) {
+        delete rects[i];
+        delete old_rects[i];
+        delete circles[i];
+        delete old_circles[i];
+    }
+}
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,89 @@
+
+//
+// This is a GUI support code to the chapters 12-16 of the book
+// "Programming -- Principles and Practice Using C++" by Bjarne Stroustrup
+//
+
+// a point cloud as one Scatter against one Circle per point:
+// memory per point and frame time, with all points in view and with few
+
+#include "Bench.h"
+#include "../GUI/Offscreen.h"
+
+using namespace Graph_lib;
+using Bench::random_int;
+
+//------------------------------------------------------------------------------
+
+const int width = 1000;
+const int height = 800;
+
+vector<Point> cloud(int n, int spread)    // n points over spread times the view
+{
+    vector<Point> v;
+    v.reserve(n);
+    for (int i = 0; i<n; ++i)
+        v.push_back(Point(random_int(0,width*spread),random_int(0,height*spread)));
+    return v;
+}
+
+double record_ms(const vector<Shape*>& v)
+// the shapes' own part of a frame: their draw() calls, without the rasterizing
+{
+    Display_list dl;
+    Soft_driver d(dl);
+    Soft_surface s(&d);
+    Fl_Surface_Device* old = Fl_Surface_Device::surface();
+    s.set_current();
+    double t = Bench::time_ms([&] {
+        dl.clear();
+        d.begin(width,height);
+        draw_all(v);
+    },3);
+    old->set_current();
+    return t;
+}
+
+double frame_ms(const vector<Shape*>& v)
+{
+    Offscreen out(width,height);
+    for (unsigned int i = 0; i<v.size(); ++i) out.attach(*v[i]);
+    out.draw();
+    return Bench::time_ms([&] { out.draw(); },3);
+}
+
+//------------------------------------------------------------------------------
+
+int main()
+{
+    const int n = 200000;
+    vector<Point> pts = cloud(n,1);
+
+    Scatter dots(Scatter::circle,6);
+    double fill_ms = Bench::time_ms([&] {
+        Scatter s(Scatter::circle,6);
+        for (int i = 0; i<n; ++i) s.add(pts[i]);
+    },1);
+    for (int i = 0; i<n; ++i) dots.add(pts[i]);
+
+    vector<Shape*> circles;
+    for (int i = 0; i<n; ++i) circles.push_back(new Circle(pts[i],3));
+
+    const vector<Shape*> one(1,&dots);
+    cout << n << " points, all in view (draw calls alone, whole frame):\n"
+         << "  Scatter: " << sizeof(Point) << " bytes/point, "
+         << record_ms(one) << " ms, " << frame_ms(one) << " ms/frame, "
+         << fill_ms << " ms to add() them all\n"
+         << "  Circles: at least " << sizeof(Circle)+sizeof(Point) << " bytes/point, "
+         << record_ms(circles) << " ms, " << frame_ms(circles) << " ms/frame\n";
+    for (int i = 0; i<n; ++i) delete circles[i];
+
+    const int m = 1000000;
+    Scatter all(cloud(m,1),Scatter::square,3);
+    Scatter few(cloud(m,10),Scatter::square,3);    // 1 in 100 in view
+    cout << m << " points:\n"
+         << "  all in view:     " << frame_ms(vector<Shape*>(1,&all)) << " ms/frame\n"
+         << "  1/100 in view:   " << frame_ms(vector<Shape*>(1,&few)) << " ms/frame\n";
+}
+
+//------------------------------------------------------------------------------
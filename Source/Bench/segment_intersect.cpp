@@ -0,0 +1,61 @@
+
+//
+// This is a GUI support code to the chapters 12-16 of the book
+// "Programming -- Principles and Practice Using C++" by Bjarne Stroustrup
+//
+
+// segment_intersect() against line_segment_intersect() called in a loop:
+// one segment tested against many, as Polygon validation and picking do
+
+#include "Bench.h"
+#include "../GUI/Intersect.h"
+
+using namespace Graph_lib;
+using Bench::random_int;
+
+//------------------------------------------------------------------------------
+
+Point random_point() { return Point(random_int(0,999),random_int(0,999)); }
+
+//------------------------------------------------------------------------------
+
+int main()
+{
+    const int n = 100000;     // segments to test against
+    const int queries = 100;
+
+    Segments s;
+    s.reserve(n);
+    for (int i = 0; i<n; ++i) s.add(random_point(),random_point());
+    vector<Point> q;
+    for (int i = 0; i<2*queries; ++i) q.push_back(random_point());
+
+    int scalar_hits = 0;
+    double scalar = Bench::time_ms([&] {
+        scalar_hits = 0;
+        Point p;
+        for (int k = 0; k<queries; ++k)
+            for (int i = 0; i<s.size(); ++i)
+                if (line_segment_intersect(q[2*k],q[2*k+1],s.start(i),s.end(i),p)) ++scalar_hits;
+    });
+
+    int batch_hits = 0;
+    vector<char> hit;
+    vector<double> t;
+    double batch = Bench::time_ms([&] {
+        batch_hits = 0;
+        for (int k = 0; k<queries; ++k)
+            batch_hits += segment_intersect(q[2*k],q[2*k+1],s,hit,t);
+    });
+
+    cout << "one segment against " << n << " segments, " << queries << " times:\n"
+         << "  line_segment_intersect loop: " << scalar << " ms, " << scalar_hits << " hits\n"
+         << "  segment_intersect:           " << batch << " ms, " << batch_hits << " hits\n"
+         << "  speedup: " << scalar/batch << '\n';
+    if (scalar_hits!=batch_hits) {
+        cerr << "the two disagree\n";
+        return 1;
+    }
+}
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,61 @@
+
+//
+// This is a GUI support code to the chapters 12-16 of the book
+// "Programming -- Principles and Practice Using C++" by Bjarne Stroustrup
+//
+
+// a telemetry plot fed at 1 kHz and redrawn at 60 Hz: Stream_polyline
+// against the Open_polyline it replaces, scrolled with move() on each sample
+
+#include "Bench.h"
+#include "../GUI/Offscreen.h"
+
+using namespace Graph_lib;
+
+//------------------------------------------------------------------------------
+
+const int width = 800;             // pixels, one per sample
+const int rate = 1000;             // samples a second
+const int seconds = 30;
+const int frame = rate/60;         // samples between redraws
+
+int sample(int i) { return 150+int(100*sin(i*0.01))+Bench::random_int(-5,5); }
+
+//------------------------------------------------------------------------------
+
+template<class S> double run(S& s)    // ms for the whole stream
+{
+    Offscreen out(width,300);
+    out.set_pool(0);
+    out.attach(s);
+    return Bench::time_ms([&] {
+        for (int i = 0; i<rate*seconds; ++i) {
+            s.move(-1,0);
+            s.add(Point(width-1,sample(i)));
+            if (i%frame==0) out.draw();
+        }
+    },1);
+}
+
+//------------------------------------------------------------------------------
+
+void report(const string& name, double ms)
+{
+    cout << "  " << name << ms << " ms for " << seconds << " s of data: "
+         << int(rate*seconds/(ms/1000)) << " samples/s sustained ("
+         << rate*seconds/(ms/1000)/rate << "x real time)\n";
+}
+
+//------------------------------------------------------------------------------
+
+int main()
+{
+    cout << rate << " Hz samples, redrawn every " << frame << " samples, "
+         << width << " pixels wide:\n";
+    Stream_polyline stream(width);
+    report("Stream_polyline: ",run(stream));
+    Open_polyline grown;
+    report("Open_polyline:   ",run(grown));
+}
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,123 @@
+
+//
+// This is a GUI support code to the chapters 12-16 of the book
+// "Programming -- Principles and Practice Using C++" by Bjarne Stroustrup
+//
+
+#include <FL/Fl.H>
+#include <FL/fl_draw.H>
+#include <FL/Fl_Device.H>
+#include <FL/Fl_Image_Surface.H>
+#include "Glyph_cache.h"
+
+//------------------------------------------------------------------------------
+
+namespace Graph_lib {
+
+//------------------------------------------------------------------------------
+
+const size_t max_stamps = 4096;    // more than any sane use; guards against runaway growth
+
+//------------------------------------------------------------------------------
+
+Glyph_cache& Glyph_cache::shared()
+{
+    static Glyph_cache c;
+    return c;
+}
+
+//------------------------------------------------------------------------------
+
+bool Glyph_cache::usable()
+{
+    return Fl_Surface_Device::surface()==Fl_Display_Device::display_device();
+}
+
+//------------------------------------------------------------------------------
+
+const Glyph_cache::Stamp& Glyph_cache::get(char c, Fl_Font f, Fl_Fontsize s, Fl_Color col)
+{
+    Key k = { (unsigned char)c, f, s, col };
+    std::map<Key,Stamp>::iterator p = stamps.find(k);
+    if (p!=stamps.end()) return p->second;
+    return stamps[k] = make(c,f,s,col);
+}
+
+//------------------------------------------------------------------------------
+
+void Glyph_cache::trim()
+{
+    if (max_stamps<stamps.size()) clear();
+}
+
+//------------------------------------------------------------------------------
+
+void Glyph_cache::clear()
+{
+    for (std::map<Key,Stamp>::iterator p = stamps.begin(); p!=stamps.end(); ++p)
+        delete p->second.img;
+    stamps.clear();
+}
+
+//------------------------------------------------------------------------------
+
+Glyph_cache::Stamp Glyph_cache::make(char c, Fl_Font f, Fl_Fontsize s, Fl_Color col)
+// draw c white on black; how white a pixel came out is how much of col it gets
+{
+    const Fl_Color oldc = fl_color();
+    const Fl_Font oldf = fl_font();
+    const Fl_Fontsize olds = fl_size();
+
+    const char str[2] = { c, 0 };
+    fl_font(f,s);
+    const int pad = 2;    // for glyphs that reach beyond their advance (italics)
+    const int ascent = fl_height()-fl_descent();
+    const int w = int(fl_width(str))+2*pad;
+    const int h = fl_height();
+
+    Stamp st = { 0, -pad, -ascent };
+    if (0<w && 0<h) {
+        Fl_Image_Surface surf(w,h);
+        surf.set_current();
+        fl_color(FL_BLACK);
+        fl_rectf(0,0,w,h);
+        fl_color(FL_WHITE);
+        fl_font(f,s);
+        fl_draw(str,pad,ascent);
+        Fl_RGB_Image* shot = surf.image();
+        Fl_Display_Device::display_device()->set_current();    // usable() said we were drawing there
+
+        uchar r, g, b;
+        Fl::get_color(col,r,g,b);
+        uchar* rgba = new uchar[w*h*4];
+        const uchar* in = shot->array;
+        bool ink = false;
+        for (int i=0; i<w*h; ++i, in+=3) {
+            uchar a = in[0];
+            if (a<in[1]) a = in[1];
+            if (a<in[2]) a = in[2];
+            rgba[4*i] = r;
+            rgba[4*i+1] = g;
+            rgba[4*i+2] = b;
+            rgba[4*i+3] = a;
+            if (a) ink = true;
+        }
+        delete shot;
+
+        if (ink) {
+            Fl_RGB_Image* img = new Fl_RGB_Image(rgba,w,h,4);
+            img->alloc_array = 1;
+            st.img = img;
+        }
+        else
+            delete[] rgba;
+    }
+
+    fl_color(oldc);
+    fl_font(oldf,olds);
+    return st;
+}
+
+//------------------------------------------------------------------------------
+
+} // of namespace Graph_lib
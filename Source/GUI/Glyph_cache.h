@@ -0,0 +1,70 @@
+
+//
+// This is a GUI support code to the chapters 12-16 of the book
+// "Programming -- Principles and Practice Using C++" by Bjarne Stroustrup
+//
+
+#ifndef GLYPH_CACHE_GUARD
+#define GLYPH_CACHE_GUARD 1
+
+#include <map>
+#include <FL/Fl_Image.H>
+#include <FL/Enumerations.H>
+
+namespace Graph_lib {
+
+//------------------------------------------------------------------------------
+
+// characters drawn once, per font, size and color, into small RGBA images
+// that are then just copied into place: for drawing the same few characters
+// at very many points. Only for the GUI thread.
+class Glyph_cache {
+public:
+    struct Stamp {
+        Fl_Image* img;    // 0 for a character that draws nothing (a space)
+        int dx, dy;       // where img goes relative to the start of the baseline
+    };
+
+    static Glyph_cache& shared();
+
+    Glyph_cache() { }
+    ~Glyph_cache() { clear(); }
+
+    // stamps can be made only while drawing to the display; elsewhere
+    // (printers, Offscreen) draw characters the usual way
+    static bool usable();
+
+    // the stamp for c drawn in font f, size s, color col;
+    // it stays valid until the next trim() or clear()
+    const Stamp& get(char c, Fl_Font f, Fl_Fontsize s, Fl_Color col);
+
+    void trim();     // forget all stamps if there are very many
+    void clear();
+
+private:
+    struct Key {
+        unsigned char c;
+        Fl_Font f;
+        Fl_Fontsize s;
+        Fl_Color col;
+        bool operator<(const Key& k) const
+        {
+            if (c!=k.c) return c<k.c;
+            if (f!=k.f) return f<k.f;
+            if (s!=k.s) return s<k.s;
+            return col<k.col;
+        }
+    };
+    std::map<Key,Stamp> stamps;
+
+    Stamp make(char c, Fl_Font f, Fl_Fontsize s, Fl_Color col);
+
+    Glyph_cache(const Glyph_cache&);    // prevent copying
+    Glyph_cache& operator=(const Glyph_cache&);
+};
+
+//------------------------------------------------------------------------------
+
+} // of namespace Graph_lib
+
+#endif // GLYPH_CACHE_GUARD
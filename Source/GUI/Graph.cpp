@@ -4,9 +4,14 @@
 // "Programming -- Principles and Practice Using C++" by Bjarne Stroustrup
 //
 
-#include <FL/Fl_GIF_Image.H>
-#include <FL/Fl_JPEG_Image.H>
+#include <algorithm>
+#include <chrono>
+#include <thread>
 #include "Graph.h"
+#include "Glyph_cache.h"
+#include "Image_cache.h"
+#include "Intersect.h"
+#include "Window.h"
 
 //------------------------------------------------------------------------------
 
@@ -14,17 +19,173 @@ namespace Graph_lib {
 
 //------------------------------------------------------------------------------
 
+int Render_state::depth = 0;
+bool Render_state::style_known = false;
+int Render_state::cur_style = 0;
+int Render_state::cur_width = 0;
+Fl_Font Render_state::base_font = 0;
+Fl_Fontsize Render_state::base_size = 0;
+
+//------------------------------------------------------------------------------
+
+Render_state::Render_state()
+    : oldc(fl_color()), oldf(fl_font()), olds(fl_size())
+{
+    if (depth++) return;    // a frame within a frame goes on with the outer one
+    style_known = false;    // there is no way of retrieving the current style
+    base_font = oldf;
+    base_size = olds;
+}
+
+//------------------------------------------------------------------------------
+
+Render_state::~Render_state()
+{
+    if (--depth) return;
+    fl_line_style(0);
+    fl_color(oldc);
+    if (fl_font()!=oldf || fl_size()!=olds) fl_font(oldf,olds);
+}
+
+//------------------------------------------------------------------------------
+
+void Render_state::color(Fl_Color c)
+{
+    if (tracking() && fl_color()==c) return;
+    fl_color(c);
+}
+
+//------------------------------------------------------------------------------
+
+void Render_state::line_style(int style, int width)
+{
+    if (tracking() && style_known && style==cur_style && width==cur_width) return;
+    fl_line_style(style,width);
+    if (!tracking()) return;
+    style_known = true;
+    cur_style = style;
+    cur_width = width;
+}
+
+//------------------------------------------------------------------------------
+
+void Render_state::font(Fl_Font f, Fl_Fontsize size)
+{
+    if (tracking() && fl_font()==f && fl_size()==size) return;
+    fl_font(f,size);
+}
+
+//------------------------------------------------------------------------------
+
+void Render_state::frame_font()
+{
+    if (tracking()) font(base_font,base_size);
+}
+
+//------------------------------------------------------------------------------
+
+void Render_state::frame_font(Fl_Font& f, Fl_Fontsize& size)
+{
+    f = tracking() ? base_font : fl_font();
+    size = tracking() ? base_size : fl_size();
+}
+
+//------------------------------------------------------------------------------
+
+struct Style_less {    // orders shapes by the graphics state they need
+    static int fill(const Shape* s)
+    {
+        return s->fill_color().visibility() ? s->fill_color().as_int() : -1;
+    }
+    static pair<int,int> font(const Shape* s)    // Texts with the same font go together
+    {
+        const Text* t = dynamic_cast<const Text*>(s);
+        return t ? make_pair(t->font().as_int(),t->font_size()) : make_pair(-1,0);
+    }
+    bool operator()(const Shape* a, const Shape* b) const
+    {
+        if (fill(a)!=fill(b)) return fill(a)<fill(b);
+        if (a->color().as_int()!=b->color().as_int()) return a->color().as_int()<b->color().as_int();
+        if (font(a)!=font(b)) return font(a)<font(b);
+        if (a->style().style()!=b->style().style()) return a->style().style()<b->style().style();
+        return a->style().width()<b->style().width();
+    }
+};
+
+//------------------------------------------------------------------------------
+
+void draw_all(const vector<Shape*>& shapes, bool by_style)
+{
+    Render_state rs;
+    if (!by_style) {
+        for (unsigned int i=0; i<shapes.size(); ++i) shapes[i]->draw();
+        return;
+    }
+
+    // shapes that don't overlap can be drawn in any order; look for runs of
+    // such shapes, not too long as each new shape is checked against the run
+    const unsigned int max_run = 64;
+    vector<Shape*> run;
+    for (unsigned int i=0; i<shapes.size(); ) {
+        run.clear();
+        for (; i<shapes.size() && run.size()<max_run; ++i) {
+            Bounds b = shapes[i]->bbox();
+            unsigned int j = 0;
+            while (j<run.size() && !intersects(run[j]->bbox(),b)) ++j;
+            if (j<run.size()) break;
+            run.push_back(shapes[i]);
+        }
+        stable_sort(run.begin(),run.end(),Style_less());
+        for (unsigned int j=0; j<run.size(); ++j) run[j]->draw();
+    }
+}
+
+//------------------------------------------------------------------------------
+
+bool remove_shape(vector<Shape*>& shapes, const Shape& s)
+{
+    vector<Shape*>::iterator p = remove(shapes.begin(),shapes.end(),&s);
+    if (p==shapes.end()) return false;
+    shapes.erase(p,shapes.end());
+    return true;
+}
+
+//------------------------------------------------------------------------------
+
+bool raise_shape(vector<Shape*>& shapes, const Shape& s)
+{
+    vector<Shape*>::iterator p = find(shapes.begin(),shapes.end(),&s);
+    if (p==shapes.end()) return false;
+    rotate(p,p+1,shapes.end());
+    return true;
+}
+
+//------------------------------------------------------------------------------
+
 Shape::Shape() : 
     lcolor(fl_color()),      // default color for lines and characters
     ls(0),                   // default style
-    fcolor(Color::invisible) // no fill
+    fcolor(Color::invisible), // no fill
+    own(0),                  // not attached
+    up(0),                   // not part of another shape
+    box_ok(false),
+    by_font(false),
+    box_drv(0)
 {}
 
 //------------------------------------------------------------------------------
 
+Shape::~Shape()
+{
+    if (own) own->detach(*this);    // don't leave the window with a dangling pointer
+}
+
+//------------------------------------------------------------------------------
+
 void Shape::add(Point p)     // protected
 {
     points.push_back(p);
+    grown(point_extent(p));    // so that adding n points isn't O(n*n)
 }
 
 //------------------------------------------------------------------------------
@@ -32,6 +193,73 @@ void Shape::add(Point p)     // protected
 void Shape::set_point(int i,Point p)        // not used; not necessary so far
 {
     points[i] = p;
+    changed();
+}
+
+//------------------------------------------------------------------------------
+
+void Shape::changed()    // protected
+// forget our bbox() and let the window repaint where we were and where we are now
+{
+    box_ok = false;
+    if (own) own->changed(*this);
+    if (up) up->part_changed(*this);
+}
+
+//------------------------------------------------------------------------------
+
+void Shape::changed(Bounds part)    // protected
+// our bbox() stays as it is; only part of what we draw is new
+{
+    if (own) own->changed(*this,part);
+    if (up) up->changed(part);
+}
+
+//------------------------------------------------------------------------------
+
+void Shape::grown(Bounds more)    // protected
+// our bbox() only gets bigger: widen it if known rather than compute it afresh
+{
+    if (box_known()) box = unite(box,more);
+    if (own) own->changed(*this);
+    if (up) up->part_changed(*this);
+}
+//------------------------------------------------------------------------------
+
+int Shape::line_pad() const    // protected
+{
+    return (1<ls.width() ? ls.width()/2 : 0) + 1;    // +1 for rounding
+}
+
+//------------------------------------------------------------------------------
+
+inline Bounds grow(Bounds b, int d)    // b with d pixels added on every side
+{
+    return b.empty() ? b : Bounds(b.x-d,b.y-d,b.w+d+d,b.h+d+d);
+}
+
+//------------------------------------------------------------------------------
+
+Bounds Shape::extent() const    // protected
+// right for shapes that draw lines between their points;
+// a shape that draws elsewhere must say so by overriding extent()
+{
+    if (points.size()==0) return Bounds();
+    int x0 = points[0].x, y0 = points[0].y, x1 = x0, y1 = y0;
+    for (unsigned int i=1; i<points.size(); ++i) {
+        if (points[i].x<x0) x0 = points[i].x;
+        if (points[i].y<y0) y0 = points[i].y;
+        if (x1<points[i].x) x1 = points[i].x;
+        if (y1<points[i].y) y1 = points[i].y;
+    }
+    return grow(Bounds(x0,y0,x1-x0+1,y1-y0+1),line_pad());
+}
+
+//------------------------------------------------------------------------------
+
+Bounds Shape::point_extent(Point p) const    // protected
+{
+    return grow(Bounds(p.x,p.y,1,1),line_pad());
 }
 
 //------------------------------------------------------------------------------
@@ -47,6 +275,12 @@ void Shape::draw_lines() const
 
 void Shape::draw() const
 {
+    if (Render_state::tracking()) {    // leave the state for the next shape
+        Render_state::color(lcolor.as_int());
+        Render_state::line_style(ls.style(),ls.width());
+        draw_lines();
+        return;
+    }
     Fl_Color oldc = fl_color();
     // there is no good portable way of retrieving the current style
     fl_color(lcolor.as_int());            // set color
@@ -65,6 +299,7 @@ void Shape::move(int dx, int dy)    // move the shape +=dx and +=dy
         points[i].x+=dx;
         points[i].y+=dy;
     }
+    changed();
 }
 
 //------------------------------------------------------------------------------
@@ -103,41 +338,137 @@ void Lines::draw_lines() const
 
 //------------------------------------------------------------------------------
 
-// does two lines (p1,p2) and (p3,p4) intersect?
-// if se return the distance of the intersect point as distances from p1
-inline pair<double,double> line_intersect(Point p1, Point p2, Point p3, Point p4, bool& parallel) 
+inline int cell_of(int v, int cs)    // round down, also for negative v
 {
-    double x1 = p1.x;
-    double x2 = p2.x;
-    double x3 = p3.x;
-    double x4 = p4.x;
-    double y1 = p1.y;
-    double y2 = p2.y;
-    double y3 = p3.y;
-    double y4 = p4.y;
+    return 0<=v ? v/cs : -((-v-1)/cs)-1;
+}
+
+//------------------------------------------------------------------------------
+
+inline long long cell_key(int cx, int cy)
+{
+    return (static_cast<long long>(cx)<<32) ^ static_cast<unsigned int>(cy);
+}
 
-    double denom = ((y4 - y3)*(x2-x1) - (x4-x3)*(y2-y1));
-    if (denom == 0){
-        parallel= true;
-        return pair<double,double>(0,0);
+//------------------------------------------------------------------------------
+
+void Edge_grid::clear(int cell_size)
+{
+    cs = cell_size<1 ? 1 : cell_size;
+    n = 0;
+    cells.clear();
+}
+
+//------------------------------------------------------------------------------
+
+void Edge_grid::cells_on(Point a, Point b, vector<long long>& keys) const
+// the cells a-b passes through, found a column at a time;
+// rounding can only add cells at the edges of the true ones
+{
+    keys.clear();
+    if (b.x<a.x) swap(a,b);
+    int cx0 = cell_of(a.x,cs), cx1 = cell_of(b.x,cs);
+    double slope = a.x==b.x ? 0 : double(b.y-a.y)/(b.x-a.x);
+    for (int cx=cx0; cx<=cx1; ++cx) {
+        double x0 = max(double(a.x),double(cx)*cs);    // the part of a-b in this column
+        double x1 = min(double(b.x),double(cx+1)*cs);
+        double y0 = a.y+slope*(x0-a.x);
+        double y1 = a.x==b.x ? b.y : a.y+slope*(x1-a.x);
+        if (y1<y0) swap(y0,y1);
+        int cy0 = cell_of(int(floor(y0-1e-6)),cs);
+        int cy1 = cell_of(int(floor(y1+1e-6)),cs);
+        for (int cy=cy0; cy<=cy1; ++cy) keys.push_back(cell_key(cx,cy));
     }
-    parallel = false;
-    return pair<double,double>( ((x4-x3)*(y1-y3) - (y4-y3)*(x1-x3))/denom,
-                                ((x2-x1)*(y1-y3) - (y2-y1)*(x1-x3))/denom);
 }
 
 //------------------------------------------------------------------------------
 
-//intersection between two line segments
-//Returns true if the two segments intersect,
-//in which case intersection is set to the point of intersection
-bool line_segment_intersect(Point p1, Point p2, Point p3, Point p4, Point& intersection){
-   bool parallel;
-   pair<double,double> u = line_intersect(p1,p2,p3,p4,parallel);
-   if (parallel || u.first < 0 || u.first > 1 || u.second < 0 || u.second > 1) return false;
-   intersection.x = p1.x + u.first*(p2.x - p1.x);
-   intersection.y = p1.y + u.first*(p2.y - p1.y);
-   return true;
+void Edge_grid::insert(int i, Point a, Point b)
+{
+    cells_on(a,b,keys);
+    for (unsigned int k=0; k<keys.size(); ++k) cells[keys[k]].push_back(i);
+    ++n;
+}
+
+//------------------------------------------------------------------------------
+
+void Edge_grid::candidates(Point a, Point b, vector<int>& res) const
+{
+    res.clear();
+    cells_on(a,b,keys);
+    for (unsigned int k=0; k<keys.size(); ++k) {
+        unordered_map<long long,vector<int> >::const_iterator p = cells.find(keys[k]);
+        if (p!=cells.end()) res.insert(res.end(),p->second.begin(),p->second.end());
+    }
+    sort(res.begin(),res.end());
+    res.erase(unique(res.begin(),res.end()),res.end());
+}
+
+//------------------------------------------------------------------------------
+
+int edge_cell_size(const vector<Point>& ps, int n)
+// about one edge per cell for the first n edges of ps, if they were spread evenly
+{
+    if (n<1) return 1;
+    int x0 = ps[0].x, y0 = ps[0].y, x1 = x0, y1 = y0;
+    for (int i=1; i<=n; ++i) {
+        x0 = min(x0,ps[i].x);
+        y0 = min(y0,ps[i].y);
+        x1 = max(x1,ps[i].x);
+        y1 = max(y1,ps[i].y);
+    }
+    return int(sqrt((double(x1-x0)+1)*(double(y1-y0)+1)/n))+1;
+}
+
+//------------------------------------------------------------------------------
+
+Polygon::Polygon(const vector<Point>& ps)
+    : indexed(0)
+// check each point just as add() would, but with all the edges indexed at once
+{
+    int n = int(ps.size());
+    if (n==0) return;
+
+    // edges are kept relative to point(0), so that move() doesn't invalidate them
+    vector<Point> qs;
+    qs.reserve(n);
+    for (int i=0; i<n; ++i) qs.push_back(Point(ps[i].x-ps[0].x,ps[i].y-ps[0].y));
+    edges.clear(edge_cell_size(qs,n-1));
+    for (int i=0; i+1<n; ++i) edges.insert(i,qs[i],qs[i+1]);
+    indexed = n-1;
+
+    vector<int> cand;
+    for (int np=1; np<n; ++np) {    // as if adding ps[np] to ps[0..np)
+        if (1<np) {
+            if (ps[np]==ps[np-1]) error("polygon point equal to previous point");
+            bool parallel;
+            line_intersect(ps[np-1],ps[np],ps[np-2],ps[np-1],parallel);
+            if (parallel)
+                error("two polygon points lie in a straight line");
+        }
+        edges.candidates(qs[np-1],qs[np],cand);
+        for (unsigned int j=0; j<cand.size() && cand[j]<np-2; ++j) {
+            Point ignore(0,0);
+            if (line_segment_intersect(ps[np-1],ps[np],ps[cand[j]],ps[cand[j]+1],ignore))
+                error("intersect in polygon");
+        }
+    }
+
+    for (int i=0; i<n; ++i) Closed_polyline::add(ps[i]);
+}
+
+//------------------------------------------------------------------------------
+
+void Polygon::index_edges()
+// rebuild edges with a cell size to suit the edges we now have
+{
+    vector<Point> ps;
+    for (int i=0; i<number_of_points(); ++i)
+        ps.push_back(Point(point(i).x-point(0).x,point(i).y-point(0).y));
+    int n = int(ps.size())-1;
+    edges.clear(edge_cell_size(ps,n));
+    for (int i=0; i<n; ++i) edges.insert(i,ps[i],ps[i+1]);
+    indexed = n;
 }
 
 //------------------------------------------------------------------------------
@@ -154,14 +485,33 @@ void Polygon::add(Point p)
             error("two polygon points lie in a straight line");
     }
 
-    for (int i = 1; i<np-1; ++i) {    // check that new segment doesn't interset and old point
-        Point ignore(0,0);
-        if (line_segment_intersect(point(np-1),p,point(i-1),point(i),ignore))
-            error("intersect in polygon");
+    const int few = 32;    // below this many edges, checking them all is fastest
+    if (np-1<few) {
+        for (int i = 1; i<np-1; ++i) {    // check that new segment doesn't interset and old point
+            Point ignore(0,0);
+            if (line_segment_intersect(point(np-1),p,point(i-1),point(i),ignore))
+                error("intersect in polygon");
+        }
+    }
+    else {    // only check edges near the new one
+        if (edges.empty() || 2*indexed<=np-1) index_edges();
+        Point o = point(0);
+        Point a(point(np-1).x-o.x,point(np-1).y-o.y);
+        Point b(p.x-o.x,p.y-o.y);
+        vector<int> cand;
+        edges.candidates(a,b,cand);
+        for (unsigned int j=0; j<cand.size() && cand[j]<np-2; ++j) {
+            Point ignore(0,0);
+            if (line_segment_intersect(point(np-1),p,point(cand[j]),point(cand[j]+1),ignore))
+                error("intersect in polygon");
+        }
     }
-    
 
     Closed_polyline::add(p);
+    if (!edges.empty()) {
+        Point o = point(0);
+        edges.insert(np-1,Point(point(np-1).x-o.x,point(np-1).y-o.y),Point(p.x-o.x,p.y-o.y));
+    }
 }
 
 //------------------------------------------------------------------------------
@@ -174,16 +524,74 @@ void Polygon::draw_lines() const
 
 //------------------------------------------------------------------------------
 
+const vector<int>& Open_polyline::drawn() const
+// Douglas-Peucker: keep the ends of a run of points, and if some point in between
+// is further than tol from the line between them, keep the furthest and do the same
+// for the runs on either side of it
+{
+    int n = number_of_points();
+    if (keep_ok && (keep.empty() ? n==0 : keep.back()==n-1)) return keep;
+
+    vector<char> use(n,0);
+    if (0<n) use[0] = use[n-1] = 1;
+    vector<pair<int,int> > runs;
+    if (2<n) runs.push_back(make_pair(0,n-1));
+    while (!runs.empty()) {
+        int a = runs.back().first, b = runs.back().second;
+        runs.pop_back();
+        double dx = point(b).x-point(a).x, dy = point(b).y-point(a).y;
+        double len = sqrt(dx*dx+dy*dy);
+        int far = -1;
+        double d = tol;
+        for (int i=a+1; i<b; ++i) {
+            double ex = point(i).x-point(a).x, ey = point(i).y-point(a).y;
+            double di = len==0 ? sqrt(ex*ex+ey*ey) : abs(dx*ey-dy*ex)/len;
+            if (d<di) {
+                d = di;
+                far = i;
+            }
+        }
+        if (far<0) continue;    // all of a..b is close enough to the line a-b
+        use[far] = 1;
+        if (1<far-a) runs.push_back(make_pair(a,far));
+        if (1<b-far) runs.push_back(make_pair(far,b));
+    }
+
+    keep.clear();
+    for (int i=0; i<n; ++i)
+        if (use[i]) keep.push_back(i);
+    keep_ok = true;
+    return keep;
+}
+
+//------------------------------------------------------------------------------
+
 void Open_polyline::draw_lines() const
 {
+    if (0<tol) {    // only the points that matter
+        const vector<int>& k = drawn();
+        if (fill_color().visibility()) {
+            Render_state::color(fill_color().as_int());
+            fl_begin_complex_polygon();
+            for (unsigned int i=0; i<k.size(); ++i)
+                fl_vertex(point(k[i]).x,point(k[i]).y);
+            fl_end_complex_polygon();
+            Render_state::color(color().as_int());    // reset color
+        }
+        if (color().visibility())
+            for (unsigned int i=1; i<k.size(); ++i)
+                fl_line(point(k[i-1]).x,point(k[i-1]).y,point(k[i]).x,point(k[i]).y);
+        return;
+    }
+
     if (fill_color().visibility()) {
-        fl_color(fill_color().as_int());
+        Render_state::color(fill_color().as_int());
         fl_begin_complex_polygon();
         for(int i=0; i<number_of_points(); ++i){
             fl_vertex(point(i).x, point(i).y);
         }
         fl_end_complex_polygon();
-        fl_color(color().as_int());    // reset color
+        Render_state::color(color().as_int());    // reset color
     }
     
     if (color().visibility())
@@ -192,6 +600,216 @@ void Open_polyline::draw_lines() const
 
 //------------------------------------------------------------------------------
 
+Stream_polyline::Stream_polyline(int capacity)
+    : first(0), n(0), added(0)
+{
+    if (capacity<=0) error("non-positive stream capacity");
+    ring.resize(capacity);
+}
+
+//------------------------------------------------------------------------------
+
+void Stream_polyline::keep(deque<Extreme>& d, int v, bool lo)
+// add v to d, after dropping what it is more extreme than, and what has left the ring
+{
+    while (!d.empty() && (lo ? v<=d.back().v : d.back().v<=v)) d.pop_back();
+    Extreme e = { added, v };
+    d.push_back(e);
+    while (d.front().seq<=added-capacity()) d.pop_front();
+}
+
+//------------------------------------------------------------------------------
+
+void Stream_polyline::add(Point p)
+{
+    p = Point(p.x-off.x,p.y-off.y);    // not moved by moves made before it came
+    if (n<capacity())
+        ring[(first+n++)%capacity()] = p;
+    else {    // overwrite the oldest
+        ring[first] = p;
+        first = (first+1)%capacity();
+    }
+    keep(x_lo,p.x,true);
+    keep(x_hi,p.x,false);
+    keep(y_lo,p.y,true);
+    keep(y_hi,p.y,false);
+    ++added;
+    changed();
+}
+
+//------------------------------------------------------------------------------
+
+void Stream_polyline::move(int dx, int dy)
+{
+    off.x += dx;
+    off.y += dy;
+    changed();
+}
+
+//------------------------------------------------------------------------------
+
+Point Stream_polyline::at(int i) const
+{
+    if (i<0 || n<=i) error("stream index out of range");
+    Point p = ring[(first+i)%capacity()];
+    return Point(p.x+off.x,p.y+off.y);
+}
+
+//------------------------------------------------------------------------------
+
+void Stream_polyline::draw_lines() const
+{
+    if (!color().visibility() || n<2) return;
+    Point a = at(0);
+    for (int i=1; i<n; ++i) {
+        Point b = at(i);
+        fl_line(a.x,a.y,b.x,b.y);
+        a = b;
+    }
+}
+
+//------------------------------------------------------------------------------
+
+Bounds Stream_polyline::extent() const
+{
+    if (n==0) return Bounds();
+    int xl = x_lo.front().v+off.x, xh = x_hi.front().v+off.x;
+    int yl = y_lo.front().v+off.y, yh = y_hi.front().v+off.y;
+    return grow(Bounds(xl,yl,xh-xl+1,yh-yl+1),line_pad());
+}
+
+//------------------------------------------------------------------------------
+
+Time_series::Time_series(Point xy, int ww, int hh, double xx0, double xx1, double yy0, double yy1)
+    : w(ww), h(hh), x0(xx0), x1(xx1), y0(yy0), y1(yy1)
+{
+    if (w<=0 || h<=0) error("Bad time series: non-positive side");
+    if (x1<=x0 || y1<=y0) error("Bad time series: empty range");
+    Shape::add(xy);
+    reset();
+}
+
+//------------------------------------------------------------------------------
+
+void Time_series::add(double x, double y)
+{
+    if (size() && x<xs.back()) error("time series x decreasing");
+    xs.push_back(x);
+    ys.push_back(y);
+    changed();    // fold() picks the new sample up
+}
+
+//------------------------------------------------------------------------------
+
+void Time_series::set_x_range(double xx0, double xx1)
+{
+    if (xx1<=xx0) error("Bad time series: empty range");
+    x0 = xx0;
+    x1 = xx1;
+    reset();
+    changed();
+}
+
+//------------------------------------------------------------------------------
+
+void Time_series::set_y_range(double yy0, double yy1)    // the columns stay valid
+{
+    if (yy1<=yy0) error("Bad time series: empty range");
+    y0 = yy0;
+    y1 = yy1;
+    changed();
+}
+
+//------------------------------------------------------------------------------
+
+void Time_series::set_width(int ww)
+{
+    if (ww<=0) error("Bad time series: non-positive side");
+    w = ww;
+    reset();
+    changed();
+}
+
+//------------------------------------------------------------------------------
+
+inline int to_pixel(double v)    // round down, and keep far away values drawable
+{
+    const double far = 30000;
+    return int(floor(v<-far ? -far : far<v ? far : v));
+}
+
+//------------------------------------------------------------------------------
+
+Point Time_series::screen(int i) const
+{
+    return Point(point(0).x+to_pixel(column(xs[i])),
+                 point(0).y+to_pixel((y1-ys[i])*h/(y1-y0)));
+}
+
+//------------------------------------------------------------------------------
+
+void Time_series::fold() const
+{
+    for (; folded<size(); ++folded) {
+        int i = folded;
+        int c = to_pixel(column(xs[i]));
+        if (c<0) {
+            before = i;
+            continue;
+        }
+        if (w<=c) {
+            if (after<0) after = i;
+            continue;
+        }
+        if (cols.empty() || cols.back().col!=c) {
+            Column k = { c, i, i, i, i };
+            cols.push_back(k);
+            continue;
+        }
+        Column& k = cols.back();
+        if (ys[i]<ys[k.low]) k.low = i;
+        if (ys[k.high]<ys[i]) k.high = i;
+        k.last = i;
+    }
+}
+
+//------------------------------------------------------------------------------
+
+void Time_series::draw_lines() const
+// as Shape::draw_lines() would for all the samples, but with at most four per column
+{
+    if (!color().visibility() || size()<2) return;
+    fold();
+
+    vector<int> v;    // the samples to draw, in order
+    if (0<=before) v.push_back(before);
+    for (unsigned int i=0; i<cols.size(); ++i) {
+        const Column& k = cols[i];
+        int s[4] = { k.first, k.low, k.high, k.last };
+        sort(s,s+4);
+        for (int j=0; j<4; ++j)
+            if (j==0 || s[j]!=s[j-1]) v.push_back(s[j]);
+    }
+    if (0<=after) v.push_back(after);
+
+    fl_push_clip(point(0).x,point(0).y,w,h);
+    for (unsigned int i=1; i<v.size(); ++i) {
+        Point a = screen(v[i-1]);
+        Point b = screen(v[i]);
+        fl_line(a.x,a.y,b.x,b.y);
+    }
+    fl_pop_clip();
+}
+
+//------------------------------------------------------------------------------
+
+Bounds Time_series::extent() const
+{
+    return Bounds(point(0).x,point(0).y,w,h);
+}
+
+//------------------------------------------------------------------------------
+
 void Closed_polyline::draw_lines() const
 {
     Open_polyline::draw_lines();    // first draw the "open poly line part"
@@ -205,13 +823,29 @@ void Closed_polyline::draw_lines() const
 
 //------------------------------------------------------------------------------
 
+struct Mark_font {    // while it exists, the font is the one marks are drawn in: the frame's
+    Mark_font()
+    {
+        Render_state::frame_font(f,s);
+        of = fl_font();
+        os = fl_size();
+        if (f!=of || s!=os) fl_font(f,s);
+    }
+    ~Mark_font() { if (f!=of || s!=os) fl_font(of,os); }
+private:
+    Fl_Font f, of;
+    Fl_Fontsize s, os;
+};
+
+//------------------------------------------------------------------------------
+
 void draw_mark(Point xy, char c)
 {
     static const int dx = 4;
     static const int dy = 4;
 
-    string m(1,c);
-    fl_draw(m.c_str(),xy.x-dx,xy.y+dy);
+    const char m[2] = { c, 0 };
+    fl_draw(m,xy.x-dx,xy.y+dy);
 }
 
 //------------------------------------------------------------------------------
@@ -219,8 +853,276 @@ void draw_mark(Point xy, char c)
 void Marked_polyline::draw_lines() const
 {
     Open_polyline::draw_lines();
-    for (int i=0; i<number_of_points(); ++i) 
-        draw_mark(point(i),mark[i%mark.size()]);
+    Render_state::frame_font();    // not that of a Text drawn before us
+    if (!Glyph_cache::usable()) {
+        for (int i=0; i<number_of_points(); ++i) 
+            draw_mark(point(i),mark[i%mark.size()]);
+        return;
+    }
+
+    // render each mark character once, then copy it to every point
+    static const int dx = 4;
+    static const int dy = 4;
+    Glyph_cache::shared().trim();    // not while we hold stamps
+    const Glyph_cache::Stamp* st[256] = { 0 };    // by character, looked up when first needed
+    const Fl_Font f = fl_font();
+    const Fl_Fontsize s = fl_size();
+    const Fl_Color col = fl_color();
+    for (int i=0; i<number_of_points(); ++i) {
+        const unsigned char c = mark[i%mark.size()];
+        if (!st[c]) st[c] = &Glyph_cache::shared().get(c,f,s,col);
+        if (Fl_Image* img = st[c]->img)
+            img->draw(point(i).x-dx+st[c]->dx,point(i).y+dy+st[c]->dy);
+    }
+}
+
+//------------------------------------------------------------------------------
+
+Bounds Marked_polyline::extent() const
+// the marks are drawn in the frame's font, a little to the left of and below each point
+{
+    Mark_font mf;
+    return grow(Open_polyline::extent(),fl_height()+4);
+}
+
+//------------------------------------------------------------------------------
+
+Bounds Marked_polyline::point_extent(Point p) const
+{
+    Mark_font mf;
+    return grow(Open_polyline::point_extent(p),fl_height()+4);
+}
+
+//------------------------------------------------------------------------------
+
+inline int marker_size(int s)
+{
+    if (s<1 || 255<s) error("bad marker size");
+    return s;
+}
+
+//------------------------------------------------------------------------------
+
+Scatter::Scatter(Kind k, int size)
+    : kind(k), mark('*'), msize(marker_size(size)), biggest(msize)
+{
+}
+
+//------------------------------------------------------------------------------
+
+Scatter::Scatter(char m)
+    : kind(glyph), mark(m), msize(1), biggest(1)
+{
+    measures_text();
+}
+
+//------------------------------------------------------------------------------
+
+Scatter::Scatter(const vector<Point>& centers, Kind k, int size)
+    : kind(k), mark('*'), msize(marker_size(size)), at(centers), biggest(msize)
+{
+}
+
+//------------------------------------------------------------------------------
+
+void Scatter::add(Point p)
+{
+    append(p,msize,color().as_int(),false,false);
+}
+
+//------------------------------------------------------------------------------
+
+void Scatter::add(Point p, int size)
+{
+    append(p,marker_size(size),color().as_int(),true,false);
+}
+
+//------------------------------------------------------------------------------
+
+void Scatter::add(Point p, int size, Color c)
+{
+    append(p,marker_size(size),c.as_int(),true,true);
+}
+
+//------------------------------------------------------------------------------
+
+void Scatter::append(Point p, int size, Fl_Color c, bool own_size, bool own_color)    // private
+{
+    if (own_size && sz.empty()) sz.assign(at.size(),msize);    // sizes of their own from now on
+    if (own_color && cols.empty()) cols.assign(at.size(),color().as_int());
+    at.push_back(p);
+    if (own_size || !sz.empty()) sz.push_back(size);    // sz may be empty if p is the first
+    if (own_color || !cols.empty()) cols.push_back(c);
+    if (biggest<size) {    // every marker's box grows
+        biggest = size;
+        changed();
+    }
+    else
+        grown(marker(p,biggest));    // so that adding n points isn't O(n*n)
+}
+
+//------------------------------------------------------------------------------
+
+void Scatter::move(int dx, int dy)
+{
+    for (unsigned int i=0; i<at.size(); ++i) {
+        at[i].x += dx;
+        at[i].y += dy;
+    }
+    changed();
+}
+
+//------------------------------------------------------------------------------
+
+const Outline& Scatter::ring(int s) const    // private
+// the outline shared by all circles of size s, as fl_arc() would draw them
+{
+    if (rings.size()<=unsigned(s)) rings.resize(s+1);
+    if (rings[s].empty()) rings[s].arc(0,0,s,s,0,360);
+    return rings[s];
+}
+
+//------------------------------------------------------------------------------
+
+Bounds Scatter::marker(Point p, int s) const    // private
+{
+    if (kind==glyph) {    // as draw_mark() puts it, in the font it draws with
+        Mark_font mf;
+        return Bounds(p.x-4-2,p.y+4-fl_height(),int(fl_width(mark))+4,fl_height()+2);
+    }
+    const int pad = line_pad();
+    return Bounds(p.x-s/2-pad,p.y-s/2-pad,s+pad+pad,s+pad+pad);
+}
+
+//------------------------------------------------------------------------------
+
+void Scatter::moved(int i, Bounds was)    // private
+// repaint just around marker i, unless it leaves our bbox()
+{
+    Bounds now = marker(at[i],size(i));
+    if (intersection(now,bbox())==now)
+        changed(unite(was,now));
+    else
+        changed();
+}
+
+//------------------------------------------------------------------------------
+
+void Scatter::set_center(int i, Point p)
+{
+    Bounds was = marker(at[i],size(i));
+    at[i] = p;
+    moved(i,was);
+}
+
+//------------------------------------------------------------------------------
+
+void Scatter::set_size(int i, int size)
+{
+    marker_size(size);
+    Bounds was = marker(at[i],this->size(i));
+    if (sz.empty()) sz.assign(at.size(),msize);
+    sz[i] = size;
+    if (biggest<size) biggest = size;
+    moved(i,was);
+}
+
+//------------------------------------------------------------------------------
+
+void Scatter::set_marker_color(int i, Color c)
+{
+    if (cols.empty()) cols.assign(at.size(),color().as_int());
+    cols[i] = c.as_int();
+    changed(marker(at[i],size(i)));
+}
+
+//------------------------------------------------------------------------------
+
+Bounds Scatter::extent() const
+{
+    if (at.empty()) return Bounds();
+    int x0 = at[0].x, y0 = at[0].y, x1 = x0, y1 = y0;
+    for (unsigned int i=1; i<at.size(); ++i) {
+        if (at[i].x<x0) x0 = at[i].x;
+        if (at[i].y<y0) y0 = at[i].y;
+        if (x1<at[i].x) x1 = at[i].x;
+        if (y1<at[i].y) y1 = at[i].y;
+    }
+    Bounds lo = marker(Point(x0,y0),biggest), hi = marker(Point(x1,y1),biggest);
+    return unite(lo,hi);
+}
+
+//------------------------------------------------------------------------------
+
+void Scatter::draw_lines() const
+{
+    Bounds b = bbox();
+    int X,Y,W,H;    // the part we are asked to repaint
+    fl_clip_box(b.x,b.y,b.w,b.h,X,Y,W,H);
+    if (W<=0 || H<=0) return;
+
+    // a marker can matter only if its center is this near the clip
+    const Bounds m = marker(Point(0,0),biggest);
+    const int x0 = X-(m.x+m.w), y0 = Y-(m.y+m.h), x1 = X+W-m.x, y1 = Y+H-m.y;
+
+    if (kind==glyph) Render_state::frame_font();    // as Marked_polyline
+    const bool fill = fill_color().visibility() && (kind==circle || kind==square);
+    const bool line = color().visibility();
+    if (fill) {
+        Render_state::color(fill_color().as_int());
+        draw_pass(x0,y0,x1,y1,true,false);
+    }
+    if (line) {    // in each marker's own color, if it has one
+        Render_state::color(color().as_int());
+        draw_pass(x0,y0,x1,y1,false,true);
+    }
+}
+
+//------------------------------------------------------------------------------
+
+void Scatter::draw_pass(int x0, int y0, int x1, int y1, bool fill, bool line) const    // private
+// draw the markers with centers in x0..x1-1, y0..y1-1
+{
+    static const int dx = 4;    // as draw_mark()
+    static const int dy = 4;
+    const bool stamp = kind==glyph && Glyph_cache::usable();
+    if (stamp) Glyph_cache::shared().trim();    // not while we hold a stamp
+    const Glyph_cache::Stamp* st = 0;
+    const char str[2] = { mark, 0 };
+    Fl_Color cur = fl_color();
+
+    for (unsigned int i=0; i<at.size(); ++i) {
+        const Point p = at[i];
+        if (p.x<x0 || x1<=p.x || p.y<y0 || y1<=p.y) continue;    // out of view
+        if (line && !cols.empty() && cols[i]!=cur) {    // fills keep fill_color()
+            fl_color(cur = cols[i]);
+            st = 0;
+        }
+        const int s = sz.empty() ? msize : sz[i];
+        const int x = p.x-s/2, y = p.y-s/2;
+        switch (kind) {
+        case circle:
+            if (fill) ring(s).draw_fill(Point(x,y));
+            if (line) ring(s).draw_line(Point(x,y),true);
+            break;
+        case square:
+            if (fill) fl_rectf(x,y,s,s);
+            if (line) fl_rect(x,y,s,s);
+            break;
+        case cross:
+            fl_xyline(x,p.y,x+s-1);
+            fl_yxline(p.x,y,y+s-1);
+            break;
+        case glyph:
+            if (stamp) {
+                if (!st) st = &Glyph_cache::shared().get(mark,fl_font(),fl_size(),cur);
+                if (st->img) st->img->draw(p.x-dx+st->dx,p.y+dy+st->dy);
+            }
+            else
+                fl_draw(str,p.x-dx,p.y+dy);
+            break;
+        }
+    }
 }
 
 //------------------------------------------------------------------------------
@@ -228,37 +1130,161 @@ void Marked_polyline::draw_lines() const
 void Rectangle::draw_lines() const
 {
     if (fill_color().visibility()) {    // fill
-        fl_color(fill_color().as_int());
+        Render_state::color(fill_color().as_int());
         fl_rectf(point(0).x,point(0).y,w,h);
     }
 
     if (color().visibility()) {    // lines on top of fill
-        fl_color(color().as_int());
+        Render_state::color(color().as_int());
         fl_rect(point(0).x,point(0).y,w,h);
     }
 }
 
 //------------------------------------------------------------------------------
 
+Bounds Rectangle::extent() const
+{
+    return grow(Bounds(point(0).x,point(0).y,w,h),line_pad());
+}
+
+//------------------------------------------------------------------------------
+
+int Rectangle_grid::add(Point xy, int ww, int hh, Color fill)
+{
+    if (hh<=0 || ww<=0) error("Bad rectangle: non-positive side");
+    xs.push_back(xy.x);
+    ys.push_back(xy.y);
+    ws.push_back(ww);
+    hs.push_back(hh);
+    fills.push_back(fill);
+    order_ok = false;
+    grown(grow(cell(size()-1),line_pad()));    // as extent() would: filling isn't O(n*n)
+    return size()-1;
+}
+
+//------------------------------------------------------------------------------
+
+struct Fill_less {    // orders cell indices by fill color
+    const vector<Color>& fills;
+    Fill_less(const vector<Color>& f) : fills(f) { }
+    bool operator()(int a, int b) const { return fills[a].as_int()<fills[b].as_int(); }
+};
+
+//------------------------------------------------------------------------------
+
+void Rectangle_grid::draw_lines() const
+// one fl_color() per fill color rather than two per cell
+{
+    if (!order_ok) {
+        order.clear();
+        for (int i=0; i<size(); ++i)
+            if (fills[i].visibility()) order.push_back(i);
+        stable_sort(order.begin(),order.end(),Fill_less(fills));
+        order_ok = true;
+    }
+
+    for (unsigned int i=0; i<order.size(); ) {
+        int c = fills[order[i]].as_int();
+        Render_state::color(c);
+        for (; i<order.size() && fills[order[i]].as_int()==c; ++i) {
+            int k = order[i];
+            fl_rectf(xs[k],ys[k],ws[k],hs[k]);
+        }
+    }
+
+    if (color().visibility()) {    // lines on top of fill
+        Render_state::color(color().as_int());
+        for (int k=0; k<size(); ++k) fl_rect(xs[k],ys[k],ws[k],hs[k]);
+    }
+}
+
+//------------------------------------------------------------------------------
+
+Bounds Rectangle_grid::extent() const
+{
+    Bounds b;
+    for (int i=0; i<size(); ++i) b = unite(b,cell(i));
+    return grow(b,line_pad());
+}
+
+//------------------------------------------------------------------------------
+
+void Rectangle_grid::move(int dx, int dy)
+{
+    for (int i=0; i<size(); ++i) {
+        xs[i]+=dx;
+        ys[i]+=dy;
+    }
+    Shape::move(dx,dy);
+}
+
+//------------------------------------------------------------------------------
+
 void Square::draw_lines() const
 {
 	if (fill_color().visibility()) {    // fill
-		fl_color(fill_color().as_int());
+		Render_state::color(fill_color().as_int());
 		fl_rectf(point(0).x, point(0).y, _area, _area);
 	}
 
 	if (color().visibility()) {    // lines on top of fill
-		fl_color(color().as_int());
+		Render_state::color(color().as_int());
 		fl_rect(point(0).x, point(0).y, _area, _area);
 	}
 }
 
 //------------------------------------------------------------------------------
 
+Bounds Square::extent() const
+{
+	return grow(Bounds(point(0).x, point(0).y, _area, _area), line_pad());
+}
+
+//------------------------------------------------------------------------------
+
 void Square::set_area(int area)
 {
 	if(area < 0) error("Bad area: non-positive area given");
 	_area = area;
+	changed();
+}
+
+//------------------------------------------------------------------------------
+
+void Outline::arc(double x, double y, double w, double h, double a1, double a2)
+{
+    const double rx = w/2, ry = h/2, cx = x+rx, cy = y+ry;
+    const double r = max(rx,ry);
+    if (r<=0.5) {    // a dot
+        add(cx,cy);
+        return;
+    }
+    // enough pieces to stay within a quarter pixel of the true curve
+    const double step = 2*acos(1-0.25/r);
+    const double rad = (a2-a1)*M_PI/180;
+    const int n = max(1,int(ceil(fabs(rad)/step)));
+    for (int i=0; i<=n; ++i) {
+        const double a = a1*M_PI/180+rad*i/n;
+        add(cx+rx*cos(a),cy-ry*sin(a));
+    }
+}
+
+//------------------------------------------------------------------------------
+
+void Outline::draw_line(Point o, bool closed) const
+{
+    if (closed) fl_begin_loop(); else fl_begin_line();
+    for (unsigned int i=0; i<xy.size(); i+=2) fl_vertex(o.x+xy[i],o.y+xy[i+1]);
+    if (closed) fl_end_loop(); else fl_end_line();
+}
+
+//------------------------------------------------------------------------------
+
+void Outline::draw_fill(Point o, bool convex) const
+{
+    if (convex) fl_begin_polygon(); else fl_begin_complex_polygon();
+    for (unsigned int i=0; i<xy.size(); i+=2) fl_vertex(o.x+xy[i],o.y+xy[i+1]);
+    if (convex) fl_end_polygon(); else fl_end_complex_polygon();
 }
 
 //------------------------------------------------------------------------------
@@ -280,16 +1306,32 @@ Point Circle::center() const
 
 void Circle::draw_lines() const
 {
-    if (color().visibility())
-        fl_arc(point(0).x,point(0).y,r+r,r+r,0,360);
+    if (!color().visibility()) return;
+    if (edge.empty()) edge.arc(0,0,r+r,r+r,0,360);
+    edge.draw_line(point(0),true);
+}
+
+//------------------------------------------------------------------------------
+
+Bounds Circle::extent() const
+{
+    return grow(Bounds(point(0).x,point(0).y,r+r+1,r+r+1),line_pad());
+}
+
+//------------------------------------------------------------------------------
+
+void Ellipse::draw_lines() const
+{
+    if (!color().visibility()) return;
+    if (edge.empty()) edge.arc(0,0,w+w,h+h,0,360);
+    edge.draw_line(point(0),true);
 }
 
 //------------------------------------------------------------------------------
 
-void Ellipse::draw_lines() const
+Bounds Ellipse::extent() const
 {
-    if (color().visibility())
-        fl_arc(point(0).x,point(0).y,w+w,h+h,0,360);
+    return grow(Bounds(point(0).x,point(0).y,w+w+1,h+h+1),line_pad());
 }
 
 //------------------------------------------------------------------------------
@@ -298,23 +1340,36 @@ void Arc::draw_lines() const
 {
 	if (fill_color().visibility()) 
 	{
-		fl_color(fill_color().as_int());
-		fl_pie(point(0).x, point(0).y, w + w - 1, h + h - 1, a1, a2); // like fl_arc but can be filled in
+		Render_state::color(fill_color().as_int());
+		if (pie.empty()) { // like fl_pie: the center, then the arc
+			pie.add((w + w - 1) / 2.0, (h + h - 1) / 2.0);
+			pie.arc(0, 0, w + w - 1, h + h - 1, a1, a2);
+		}
+		pie.draw_fill(point(0), fabs(a2 - a1) <= 180);    // a bigger pie is concave
 	}
 
 	if (color().visibility()) 
 	{
-		fl_color(color().as_int());
-		fl_arc(point(0).x, point(0).y, w + w, h + h, a1, a2); 
+		Render_state::color(color().as_int());
+		if (edge.empty()) edge.arc(0, 0, w + w, h + h, a1, a2);
+		edge.draw_line(point(0), false);
 	}
 }
 
 //------------------------------------------------------------------------------
 
+Bounds Arc::extent() const    // the whole ellipse; good enough
+{
+	return grow(Bounds(point(0).x, point(0).y, w + w + 1, h + h + 1), line_pad());
+}
+
+//------------------------------------------------------------------------------
+
 void Arc::set_angles(int a, int b) 
 {
 	a1 = a;
 	a2 = b;
+	reshape();
 }
 
 //------------------------------------------------------------------------------
@@ -327,36 +1382,39 @@ Rounded_Rect::Rounded_Rect(Point xy, int w, int h) : width(w), height(h)
 
 //------------------------------------------------------------------------------
 
+// the outline of a w*h rectangle with corners of radius r, relative to its bottom left
+inline void rounded_outline(Outline& o, int w, int h, int r)
+{
+	o.arc(w - r * 2, -h, r * 2, r * 2, 0, 90);      //right top angle
+	o.arc(0, -h, r * 2, r * 2, 90, 180);            //left top angle
+	o.arc(0, -r * 2, r * 2, r * 2, 180, 270);       //left bottom angle
+	o.arc(w - r * 2, -r * 2, r * 2, r * 2, 270, 360); //right bottom angle
+}
+
+//------------------------------------------------------------------------------
+
 void Rounded_Rect::draw_lines() const
 {
+	if (edge.empty()) rounded_outline(edge, width, height, radius);
+
 	if (fill_color().visibility())
 	{
-		fl_color(fill_color().as_int());
-
-		fl_rectf(point(0).x, point(0).y - height + radius, radius, height - radius * 2); //top rect
-		fl_rectf(point(0).x + radius, point(0).y - height, width - radius * 2, height); //middle rect
-		fl_rectf(point(0).x + width - radius, point(0).y - height + radius, radius, height - radius * 2); //bottom rect
-
-		fl_pie(point(0).x + width - radius * 2, point(0).y - height, radius * 2 - 1, radius * 2 - 1, 0, 90); //right top angle
-		fl_pie(point(0).x, point(0).y - height, radius * 2 - 1, radius * 2 - 1, 90, 180); //left top angle
-		fl_pie(point(0).x, point(0).y - radius * 2, radius * 2 - 1, radius * 2 - 1, 180, 270); //left bottom angle
-		fl_pie(point(0).x + width - radius * 2, point(0).y - radius * 2, radius * 2 - 1, radius * 2 - 1, 270, 360); //right bottom angle
+		Render_state::color(fill_color().as_int());
+		edge.draw_fill(point(0));
 	}
 
 	if (color().visibility())
 	{
-		fl_color(color().as_int());
+		Render_state::color(color().as_int());
+		edge.draw_line(point(0), true);
+	}
+}
 
-		fl_line(point(0).x + radius, point(0).y - height, point(0).x + width - radius, point(0).y - height); //top line
-		fl_line(point(0).x, point(0).y - radius, point(0).x, point(0).y - height + radius); //left line
-		fl_line(point(0).x + width, point(0).y - radius, point(0).x + width, point(0).y - height + radius); //right line
-		fl_line(point(0).x + radius, point(0).y, point(0).x + width - radius, point(0).y); //bottom line
+//------------------------------------------------------------------------------
 
-		fl_arc(point(0).x + width - radius * 2, point(0).y - height, radius * 2, radius * 2, 0, 90); //right top angle
-		fl_arc(point(0).x, point(0).y - height, radius * 2, radius * 2, 90, 180); //left top angle
-		fl_arc(point(0).x, point(0).y - radius * 2, radius * 2, radius * 2, 180, 270); //left bottom angle
-		fl_arc(point(0).x + width - radius * 2, point(0).y - radius * 2, radius * 2, radius * 2, 270, 360); //right bottom angle
-	}
+Bounds Rounded_Rect::extent() const    // point(0) is the bottom left corner
+{
+	return grow(Bounds(point(0).x, point(0).y - height, width + 1, height + 1), line_pad());
 }
 
 //------------------------------------------------------------------------------
@@ -365,6 +1423,8 @@ void Rounded_Rect::set_width(int w)
 {
 	width = w;
 	radius = (width < height) ? width / 4 : height / 4;
+	edge.clear();
+	changed();
 }
 
 //------------------------------------------------------------------------------
@@ -373,6 +1433,8 @@ void Rounded_Rect::set_height(int h)
 {
 	height = h;
 	radius = (width < height) ? width / 4 : height / 4;
+	edge.clear();
+	changed();
 }
 
 //------------------------------------------------------------------------------
@@ -387,42 +1449,36 @@ Rounded_Square::Rounded_Square(Point xy, int area): area(area)
 
 void Rounded_Square::draw_lines() const 
 {
+	if (edge.empty()) rounded_outline(edge, area, area, radius);
+
 	if (fill_color().visibility())
 	{
-		fl_color(fill_color().as_int());
-
-		fl_rectf(point(0).x, point(0).y - area + radius, radius, area - radius * 2); //top rect
-		fl_rectf(point(0).x + radius, point(0).y - area, area - radius * 2, area); //middle rect
-		fl_rectf(point(0).x + area - radius, point(0).y - area + radius, radius, area - radius * 2); //bottom rect
-
-		fl_pie(point(0).x + area - radius * 2, point(0).y - area, radius * 2, radius * 2, 0, 90); //right top angle
-		fl_pie(point(0).x, point(0).y - area, radius * 2, radius * 2, 90, 180); //left top angle
-		fl_pie(point(0).x, point(0).y - area + radius * 2, radius * 2, radius * 2, 180, 270); //left bottom angle
-		fl_pie(point(0).x + area - radius * 2, point(0).y - area + radius * 2, radius * 2, radius * 2, 270, 360); //right bottom angle
+		Render_state::color(fill_color().as_int());
+		edge.draw_fill(point(0));
 	}
 
 	if (color().visibility())
 	{
-		fl_color(color().as_int());
-		
-		fl_line(point(0).x + radius, point(0).y - area, point(0).x + area - radius, point(0).y - area); //top line
-		fl_line(point(0).x, point(0).y - radius, point(0).x, point(0).y - area + radius); //left line
-		fl_line(point(0).x + area, point(0).y - radius, point(0).x + area, point(0).y - area + radius); //right line
-		fl_line(point(0).x + radius, point(0).y, point(0).x + area - radius, point(0).y); //bottom line
-
-		fl_arc(point(0).x + area - radius * 2, point(0).y - area, radius * 2, radius * 2, 0, 90); //right top angle
-		fl_arc(point(0).x, point(0).y - area, radius * 2, radius * 2, 90, 180); //left top angle
-		fl_arc(point(0).x, point(0).y - area + radius * 2, radius * 2, radius * 2, 180, 270); //left bottom angle
-		fl_arc(point(0).x + area - radius * 2, point(0).y - area + radius * 2, radius * 2, radius * 2, 270, 360); //right bottom angle
+		Render_state::color(color().as_int());
+		edge.draw_line(point(0), true);
 	}
 }
 
 //------------------------------------------------------------------------------
 
+Bounds Rounded_Square::extent() const    // point(0) is the bottom left corner
+{
+	return grow(Bounds(point(0).x, point(0).y - area, area + 1, area + 1), line_pad());
+}
+
+//------------------------------------------------------------------------------
+
 void Rounded_Square::set_area(int a)
 {
 	area = a;
 	radius = area / 4;
+	edge.clear();
+	changed();
 }
 
 //------------------------------------------------------------------------------
@@ -459,25 +1515,327 @@ void Arrow::draw_lines() const
 
 	// draw arrowhead
 	if (color().visibility()) {
-		fl_color(fill_color().as_int());
+		Render_state::color(fill_color().as_int());
 		fl_begin_complex_polygon();
 		fl_vertex(point(1).x,point(1).y);
 		fl_vertex(pl_x,pl_y);
 		fl_vertex(pr_x,pr_y);
 		fl_end_complex_polygon();
-		fl_color(color().as_int());
+		Render_state::color(color().as_int());
 	}
 }
 
 //------------------------------------------------------------------------------
 
-void Text::draw_lines() const
+Bounds Arrow::extent() const    // the arrowhead sticks out 10 pixels from the line
+{
+	return grow(Line::extent(), 11);
+}
+
+//------------------------------------------------------------------------------
+
+void Text::lay_out() const    // private
 {
+    if (lay_ok && lay_drv==fl_graphics_driver) return;
     int ofnt = fl_font();
     int osz = fl_size();
     fl_font(fnt.as_int(),fnt_sz);
-    fl_draw(lab.c_str(),point(0).x,point(0).y);
+    lh = fl_height();
+    ld = fl_descent();
+    lw = 0;
+    lines.clear();
+
+    const char* p = lab.c_str();
+    const int n = int(lab.size());
+    for (int first=0; first<=n; ) {    // a line per '\n'-separated paragraph, or more if wrapping
+        int end = first;
+        while (end<n && p[end]!='\n') ++end;
+        int s = first;
+        while (true) {
+            int e = end;
+            if (wrap && wrap<fl_width(p+s,end-s)) {    // find the last space that lets s..e fit
+                int b = -1;
+                for (int i=s+1; i<end; ++i)
+                    if (p[i]==' ') {
+                        if (wrap<fl_width(p+s,i-s)) break;
+                        b = i;
+                    }
+                if (b<0) {    // a word longer than a line: break after it
+                    b = s+1;
+                    while (b<end && p[b]!=' ') ++b;
+                }
+                e = b;
+            }
+            Line ln = { s, e-s };
+            lines.push_back(ln);
+            const int w = int(fl_width(p+s,e-s))+1;
+            if (lw<w) lw = w;
+            if (e==end) break;
+            s = e+1;    // past the space
+        }
+        first = end+1;
+    }
+
     fl_font(ofnt,osz);
+    lay_ok = true;
+    lay_drv = fl_graphics_driver;
+}
+
+//------------------------------------------------------------------------------
+
+void Text::draw_lines() const
+{
+    draw_at(point(0));
+}
+
+//------------------------------------------------------------------------------
+
+void Text::draw_at(Point xy) const
+{
+    lay_out();
+    int ofnt = 0;
+    int osz = 0;
+    const bool restore = !Render_state::tracking();
+    if (restore) {
+        ofnt = fl_font();
+        osz = fl_size();
+    }
+    Render_state::font(fnt.as_int(),fnt_sz);
+    const char* p = lab.c_str();
+    for (unsigned int i=0; i<lines.size(); ++i)
+        if (lines[i].n) fl_draw(p+lines[i].first,lines[i].n,xy.x,xy.y+int(i)*lh);
+    if (restore) fl_font(ofnt,osz);
+}
+
+//------------------------------------------------------------------------------
+
+Bounds Text::extent() const
+{
+    if (lab=="") return Bounds();
+    lay_out();
+    // point(0) is on the first baseline; allow a pixel for slanted fonts:
+    return grow(Bounds(point(0).x,point(0).y-(lh-ld),lw,lh*int(lines.size())),1);
+}
+
+//------------------------------------------------------------------------------
+
+Labels::~Labels()
+{
+    for (unsigned int i=0; i<entries.size(); ++i)
+        release(*entries[i].t);    // so that they no longer tell us of changes
+}
+
+//------------------------------------------------------------------------------
+
+void Labels::add(Text& t, int priority)
+{
+    if (which.count(&t)) error("Labels::add(): label added twice");
+    if (contained(t)) error("Labels::add(): label is part of another shape");
+    Entry e = { &t, priority, order++, Bounds(), -1, true, false };
+    which[&t] = int(entries.size());
+    entries.push_back(e);
+    fresh.push_back(int(entries.size())-1);
+    contain(t);    // t's moves are our changes
+    changed();
+}
+
+//------------------------------------------------------------------------------
+
+void Labels::part_changed(Shape& part)    // protected
+{
+    Entry& e = entries[which.find(&part)->second];
+    if (!e.moved) {
+        e.moved = true;
+        moved.push_back(which.find(&part)->second);
+    }
+    changed();
+}
+
+//------------------------------------------------------------------------------
+
+bool Labels::is_placed(const Text& t) const
+{
+    std::unordered_map<const Shape*,int>::const_iterator p = which.find(&t);
+    if (p==which.end()) return false;
+    bbox();    // bring the placement up to date
+    return 0<=entries[p->second].at;
+}
+
+//------------------------------------------------------------------------------
+
+Bounds Labels::place(const Entry& e, int i)    // private
+// 0: where the label is, 1: left of its point, 2: below it, 3: both
+{
+    Bounds b = e.home;
+    if (i&1) b.x -= b.w;
+    if (i&2) b.y += b.h;
+    return b;
+}
+
+//------------------------------------------------------------------------------
+
+Bounds Labels::reach(const Entry& e)    // private
+{
+    return unite(place(e,0),place(e,places-1));
+}
+
+//------------------------------------------------------------------------------
+
+bool Labels::outranks(int a, int b) const    // private
+{
+    if (entries[a].priority!=entries[b].priority) return entries[a].priority>entries[b].priority;
+    return entries[a].order<entries[b].order;
+}
+
+//------------------------------------------------------------------------------
+
+void Labels::put(const Entry& e) const    // private
+{
+    Bounds b = place(e,e.at);
+    placed.insert(e.t,b);
+    if (b.empty()) return;
+    x0s.insert(b.x);
+    y0s.insert(b.y);
+    x1s.insert(b.x+b.w);
+    y1s.insert(b.y+b.h);
+}
+
+//------------------------------------------------------------------------------
+
+void Labels::take(const Entry& e) const    // private
+// e's home and place are those it was put() with
+{
+    Bounds b = place(e,e.at);
+    placed.erase(e.t);
+    if (b.empty()) return;
+    x0s.erase(x0s.find(b.x));
+    y0s.erase(y0s.find(b.y));
+    x1s.erase(x1s.find(b.x+b.w));
+    y1s.erase(y1s.find(b.y+b.h));
+}
+
+//------------------------------------------------------------------------------
+
+void Labels::update() const    // private
+// place again the labels that moved, and those that may fit where they were
+{
+    if (at_drv!=fl_graphics_driver) {    // fonts measure differently: every label may have moved
+        for (unsigned int i=0; i<entries.size(); ++i)
+            if (!entries[i].moved) {
+                entries[i].moved = true;
+                moved.push_back(i);
+            }
+        at_drv = fl_graphics_driver;
+    }
+    for (unsigned int m=0; m<moved.size(); ++m) {
+        const int i = moved[m];
+        Entry& e = entries[i];
+        e.moved = false;
+        if (e.queued) continue;
+        Bounds b = e.t->bbox();
+        if (b==e.home) continue;    // a new look, but in the same place
+        Bounds freed;
+        if (0<=e.at) {
+            freed = place(e,e.at);
+            take(e);
+        }
+        else
+            dropped.erase(e.t);
+        e.home = b;
+        e.queued = true;
+        fresh.push_back(i);
+        if (freed.empty()) continue;
+        vector<Shape*> v = dropped.in(freed);    // they may fit now
+        for (unsigned int j=0; j<v.size(); ++j) {
+            int k = which.find(v[j])->second;
+            dropped.erase(v[j]);
+            entries[k].queued = true;
+            fresh.push_back(k);
+        }
+    }
+    moved.clear();
+    if (fresh.empty()) return;
+
+    auto less = [this](int a, int b) { return outranks(b,a); };    // most important first
+    priority_queue<int,vector<int>,decltype(less)> q(less,fresh);
+    fresh.clear();
+    while (!q.empty()) {
+        const int i = q.top();
+        q.pop();
+        Entry& e = entries[i];
+        e.queued = false;
+        e.home = e.t->bbox();
+        e.at = -1;
+
+        // the first free place; else the first taken only by less important labels
+        int bump = -1;
+        vector<Shape*> in_bump;
+        for (int k=0; k<places && e.at<0; ++k) {
+            vector<Shape*> v = placed.in(place(e,k));
+            if (v.empty()) {
+                e.at = k;
+                break;
+            }
+            if (bump<0) {
+                unsigned int j = 0;
+                while (j<v.size() && outranks(i,which.find(v[j])->second)) ++j;
+                if (j==v.size()) {
+                    bump = k;
+                    in_bump.swap(v);
+                }
+            }
+        }
+        if (e.at<0 && 0<=bump) {
+            for (unsigned int j=0; j<in_bump.size(); ++j) {
+                int k = which.find(in_bump[j])->second;
+                Bounds freed = place(entries[k],entries[k].at);
+                take(entries[k]);
+                entries[k].at = -1;
+                entries[k].queued = true;
+                q.push(k);
+                vector<Shape*> v = dropped.in(freed);    // where e doesn't cover, they may fit
+                for (unsigned int m=0; m<v.size(); ++m) {
+                    int d = which.find(v[m])->second;
+                    dropped.erase(v[m]);
+                    entries[d].queued = true;
+                    q.push(d);
+                }
+            }
+            e.at = bump;
+        }
+
+        if (0<=e.at)
+            put(e);
+        else
+            dropped.insert(e.t,reach(e));
+    }
+}
+
+//------------------------------------------------------------------------------
+
+Bounds Labels::extent() const
+{
+    update();    // every change of a label comes here: it makes our bbox() stale
+    if (x0s.empty()) return Bounds();
+    return Bounds(*x0s.begin(),*y0s.begin(),*x1s.rbegin()-*x0s.begin(),*y1s.rbegin()-*y0s.begin());
+}
+
+//------------------------------------------------------------------------------
+
+void Labels::draw_lines() const
+{
+    Bounds b = bbox();    // also brings the placement up to date
+    int X,Y,W,H;    // the part we are asked to repaint
+    fl_clip_box(b.x,b.y,b.w,b.h,X,Y,W,H);
+    if (W<=0 || H<=0) return;
+    vector<Shape*> v = placed.in(Bounds(X,Y,W,H));
+    for (unsigned int i=0; i<v.size(); ++i) {
+        const Entry& e = entries[which.find(v[i])->second];
+        if (!e.t->color().visibility()) continue;
+        Render_state::color(e.t->color().as_int());
+        Bounds at = place(e,e.at);
+        e.t->draw_at(Point(e.t->point(0).x+at.x-e.home.x,e.t->point(0).y+at.y-e.home.y));
+    }
 }
 
 //------------------------------------------------------------------------------
@@ -486,6 +1844,9 @@ Axis::Axis(Orientation d, Point xy, int length, int n, string lab) :
     label(Point(0,0),lab)
 {
     if (length<0) error("bad axis length");
+    contain(label);
+    contain(notches);
+    measures_text();    // our extent() holds the label's
     switch (d){
     case Axis::x:
     {
@@ -537,6 +1898,13 @@ void Axis::draw_lines() const
 
 //------------------------------------------------------------------------------
 
+Bounds Axis::extent() const
+{
+    return unite(Shape::extent(),unite(notches.bbox(),label.bbox()));
+}
+
+//------------------------------------------------------------------------------
+
 void Axis::set_color(Color c)
 {
     Shape::set_color(c);
@@ -557,17 +1925,24 @@ void Axis::move(int dx, int dy)
 
 Function::Function(Fct f, double r1, double r2, Point xy,
                    int count, double xscale, double yscale)
-// graph f(x) for x in [r1:r2) using count line segments with (0,0) displayed at xy
-// x coordinates are scaled by xscale and y coordinates scaled by yscale
 {
-    if (r2-r1<=0) error("bad graphing range");
-    if (count <=0) error("non-positive graphing count");
-    double dist = (r2-r1)/count;
-    double r = r1;
-    for (int i = 0; i<count; ++i) {
-        add(Point(xy.x+int(r*xscale),xy.y-int(f(r)*yscale)));
-        r += dist;
-    }
+    sample(f,r1,r2,xy,count,xscale,yscale,0);
+}
+
+//------------------------------------------------------------------------------
+
+Function::Function(Fct f, double r1, double r2, Point xy, Adaptive ad,
+                   int count, double xscale, double yscale)
+{
+    refine(f,r1,r2,xy,ad,count,xscale,yscale);
+}
+
+//------------------------------------------------------------------------------
+
+Function::Function(Fct f, double r1, double r2, Point xy,
+                   int count, double xscale, double yscale, Thread_pool& pool)
+{
+    sample(f,r1,r2,xy,count,xscale,yscale,&pool);
 }
 
 //------------------------------------------------------------------------------
@@ -595,6 +1970,12 @@ Suffix::Encoding get_encoding(const string& s)
         {".jpg",  Suffix::jpg},
         {".jpeg", Suffix::jpg},
         {".gif",  Suffix::gif},
+        {".png",  Suffix::png},
+        {".bmp",  Suffix::bmp},
+        {".pnm",  Suffix::pnm},
+        {".pbm",  Suffix::pnm},
+        {".pgm",  Suffix::pnm},
+        {".ppm",  Suffix::pnm},
     };
 
     for (int i = 0, n = ARRAY_SIZE(smap); i < n; i++)
@@ -610,32 +1991,162 @@ Suffix::Encoding get_encoding(const string& s)
 
 //------------------------------------------------------------------------------
 
-// somewhat over-elaborate constructor
-// because errors related to image files can be such a pain to debug
-Image::Image(Point xy, string s, Suffix::Encoding e)
-    :w(0), h(0), fn(xy,"")
+struct Image::Pending {    // handed from the GUI thread to a worker and back
+    Image* owner;    // 0 once the Image is gone
+    string name;
+    Suffix::Encoding e;
+    int ww, hh;      // the box to fit into, or 0,0
+    Fl_Image* p;     // the decoded image, or 0
+};
+
+//------------------------------------------------------------------------------
+
+Image::Image(Point xy, string s, Suffix::Encoding e, Load::Mode m)
+    :w(0), h(0), sw(0), sh(0), file(s), enc(e), fit(0), cached(false), pending(0), fn(xy,""), tile(0)
 {
+    contain(fn);
+    measures_text();    // our extent() holds fn's
     add(xy);
+    load(m);
+}
+
+//------------------------------------------------------------------------------
+
+Image::Image(Point xy, string s, int ww, int hh, Suffix::Encoding e, Load::Mode m)
+    :w(0), h(0), sw(ww), sh(hh), file(s), enc(e), fit(0), cached(false), pending(0), fn(xy,""), tile(0)
+{
+    contain(fn);
+    measures_text();    // our extent() holds fn's
+    add(xy);
+    load(m);
+}
+
+//------------------------------------------------------------------------------
+
+inline Fl_Image* get_image(const string& s, Suffix::Encoding e, int ww, int hh)
+{
+    return ww&&hh ? Image_cache::shared().get(s,e,ww,hh) : Image_cache::shared().get(s,e);
+}
+
+//------------------------------------------------------------------------------
+
+// somewhat over-elaborate loading
+// because errors related to image files can be such a pain to debug
+void Image::load(Load::Mode m)    // private
+{
+    // the file is opened only to be decoded (its first bytes tell the format);
+    // why that failed is looked into only if it did
+    const string& s = file;
+    if (m == Load::later) {
+        static bool threads = (Fl::lock(), true);    // Fl::awake() needs this once, on the GUI thread
+        (void)threads;
+        p = new Loading_image(30,20);
+        Pending* q = new Pending;
+        q->owner = this;
+        q->name = s;
+        q->e = enc;
+        q->ww = sw;
+        q->hh = sh;
+        q->p = 0;
+        pending = q;
+        Thread_pool::shared().run([q] {
+            {
+                Image_cache::Worker w;    // leave deleting images to the GUI thread
+                q->p = get_image(q->name,q->e,q->ww,q->hh);
+            }
+            while (Fl::awake(&Image::loaded,q)<0)    // FLTK's queue is full: let the GUI thread catch up
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        });
+        return;
+    }
 
-    if (!can_open(s)) {    // can we open s?
-        fn.set_label("cannot open \""+s+'\"');
-        p = new Bad_image(30,20);    // the "error image"
+    p = get_image(s,enc,sw,sh);    // decoded once for all Images of s
+    if (!p) {
+        failed();
         return;
     }
+    cached = true;
+    refit();
+}
 
-    if (e == Suffix::none) e = get_encoding(s);
+//------------------------------------------------------------------------------
 
-    switch(e) {        // check if it is a known encoding
-    case Suffix::jpg:
-        p = new Fl_JPEG_Image(s.c_str());
-        break;
-    case Suffix::gif:
-        p = new Fl_GIF_Image(s.c_str());
-        break;
-    default:    // Unsupported image encoding
-        fn.set_label("unsupported file type \""+s+'\"');
-        p = new Bad_image(30,20);    // the "error image"
+void Image::failed()    // private
+{
+    if (!can_open(file))    // can we open file?
+        fn.set_label("cannot open \""+file+'\"');
+    else    // Unsupported image encoding
+        fn.set_label("unsupported file type \""+file+'\"');
+    p = new Bad_image(30,20);    // the "error image"
+}
+
+//------------------------------------------------------------------------------
+
+void Image::loaded(void* v)    // on the GUI thread, once a Load::later decode is done
+{
+    Pending* q = static_cast<Pending*>(v);
+    Image_cache::shared().collect();    // what the worker dropped
+    Image* im = q->owner;
+    if (!im) {    // nobody wants it any more
+        if (q->p) Image_cache::shared().release(q->p);
+        delete q;
+        return;
+    }
+
+    delete im->p;    // the Loading_image
+    if (q->p) {
+        im->p = q->p;
+        im->cached = true;
+        im->refit();
+    }
+    else
+        im->failed();
+    im->pending = 0;
+    delete q;
+    im->changed();    // repaints just where the placeholder was and the image is
+}
+
+//------------------------------------------------------------------------------
+
+void Image::set_size(int ww, int hh)
+{
+    sw = ww;
+    sh = hh;
+    if (cached) {    // a different level of the image may do now
+        if (Fl_Image* q = get_image(file,enc,sw,sh)) {
+            Image_cache::shared().release(p);
+            p = q;
+        }
     }
+    refit();    // a Load::later image is fitted when it arrives
+    changed();
+}
+
+//------------------------------------------------------------------------------
+
+void Image::refit()    // private
+{
+    drop_tiles();
+    delete fit;
+    fit = 0;
+    if (!cached || !sw || !sh) return;
+    const double scale = min(double(sw)/p->w(),double(sh)/p->h());
+    const int fw = max(1,int(p->w()*scale+0.5));
+    const int fh = max(1,int(p->h()*scale+0.5));
+    if (fw!=p->w() || fh!=p->h()) fit = p->copy(fw,fh);
+}
+
+//------------------------------------------------------------------------------
+
+Image::~Image()
+{
+    if (pending) pending->owner = 0;    // loaded() will clean up
+    drop_tiles();
+    delete fit;
+    if (cached)
+        Image_cache::shared().release(p);
+    else
+        delete p;
 }
 
 //------------------------------------------------------------------------------
@@ -644,10 +2155,135 @@ void Image::draw_lines() const
 {
     if (fn.label()!="") fn.draw_lines();
 
+    if (tile && 0<shown()->d() && shown()->count()) {    // pixels we can point into
+        draw_tiles();
+        return;
+    }
+
     if (w&&h)
-        p->draw(point(0).x,point(0).y,w,h,cx,cy);
+        shown()->draw(point(0).x,point(0).y,w,h,cx,cy);
     else
-        p->draw(point(0).x,point(0).y);
+        shown()->draw(point(0).x,point(0).y);
+}
+
+//------------------------------------------------------------------------------
+
+void Image::draw_tiles() const    // private
+{
+    const Fl_Image* img = shown();
+    const int iw = img->w(), ih = img->h(), d = img->d();
+    const int ld = img->ld() ? img->ld() : iw*d;
+    const uchar* pix = (const uchar*)img->data()[0];
+    const int nx = (iw+tile-1)/tile, ny = (ih+tile-1)/tile;
+    if (tiles.size()!=size_t(nx*ny)) {
+        drop_tiles();
+        tiles.assign(nx*ny,0);
+    }
+
+    // image pixel (x,y) goes to (sx+x,sy+y); the mask is the part we show
+    const int sx = point(0).x-(w&&h ? cx : 0), sy = point(0).y-(w&&h ? cy : 0);
+    Bounds view = intersection(Bounds(0,0,iw,ih),
+                               w&&h ? Bounds(cx,cy,w,h) : Bounds(0,0,iw,ih));
+    if (Fl_Window* win = Fl_Window::current())    // what the window can show
+        view = intersection(view,Bounds(-sx,-sy,win->w(),win->h()));
+
+    // of that, what we are asked to repaint
+    int X,Y,W,H;
+    fl_clip_box(sx+view.x,sy+view.y,view.w,view.h,X,Y,W,H);
+    const Bounds draw = intersection(view,Bounds(X-sx,Y-sy,W,H));
+
+    if (!draw.empty()) {
+        for (int ty=draw.y/tile; ty<=(draw.y+draw.h-1)/tile; ++ty)
+            for (int tx=draw.x/tile; tx<=(draw.x+draw.w-1)/tile; ++tx) {
+                const Bounds tb(tx*tile,ty*tile,min(tile,iw-tx*tile),min(tile,ih-ty*tile));
+                Fl_RGB_Image*& t = tiles[ty*nx+tx];
+                if (!t) t = new Fl_RGB_Image(pix+size_t(tb.y)*ld+tb.x*d,tb.w,tb.h,d,ld);
+                const Bounds r = intersection(tb,draw);
+                t->draw(sx+r.x,sy+r.y,r.w,r.h,r.x-tb.x,r.y-tb.y);
+            }
+    }
+
+    // tiles more than one tile away from the view are dropped, so that FLTK
+    // frees whatever it keeps for drawing them; they are remade if they come back
+    int kx0 = -1, kx1 = -2, ky0 = -1, ky1 = -2;    // tiles to keep
+    if (!view.empty()) {
+        kx0 = view.x/tile-1; kx1 = (view.x+view.w-1)/tile+1;
+        ky0 = view.y/tile-1; ky1 = (view.y+view.h-1)/tile+1;
+    }
+    for (int i=0; i<int(tiles.size()); ++i) {
+        if (!tiles[i]) continue;
+        const int tx = i%nx, ty = i/nx;
+        if (tx<kx0 || kx1<tx || ty<ky0 || ky1<ty) {
+            delete tiles[i];
+            tiles[i] = 0;
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+
+void Image::drop_tiles() const    // private
+{
+    for (int i=0; i<int(tiles.size()); ++i) delete tiles[i];
+    tiles.clear();
+}
+
+//------------------------------------------------------------------------------
+
+Bounds Image::extent() const
+{
+    Bounds b = w&&h ? Bounds(point(0).x,point(0).y,w,h)
+                    : Bounds(point(0).x,point(0).y,shown()->w(),shown()->h());
+    return unite(b,fn.bbox());
+}
+
+//------------------------------------------------------------------------------
+
+Pixel_buffer::Pixel_buffer(Point xy, const unsigned char* buf, int ww, int hh, int dd, int stride)
+    : pix(buf), w(ww), h(hh), d(dd), ld(stride ? stride : ww*dd)
+{
+    if (w<0 || h<0 || d<1 || 4<d) error("bad pixel buffer size");
+    add(xy);
+}
+
+//------------------------------------------------------------------------------
+
+void Pixel_buffer::set_buffer(const unsigned char* buf, int ww, int hh, int dd, int stride)
+{
+    if (ww<0 || hh<0 || dd<1 || 4<dd) error("bad pixel buffer size");
+    pix = buf;
+    w = ww;
+    h = hh;
+    d = dd;
+    ld = stride ? stride : ww*dd;
+    changed();
+}
+
+//------------------------------------------------------------------------------
+
+void Pixel_buffer::update(int x, int y, int ww, int hh)
+{
+    Point o = point(0);
+    changed(intersection(Bounds(o.x+x,o.y+y,ww,hh),Bounds(o.x,o.y,w,h)));
+}
+
+//------------------------------------------------------------------------------
+
+void Pixel_buffer::draw_lines() const
+{
+    if (!pix) return;
+    Point o = point(0);
+    int X,Y,W,H;    // the part we are asked to repaint
+    fl_clip_box(o.x,o.y,w,h,X,Y,W,H);
+    if (W<=0 || H<=0) return;
+    fl_draw_image(pix+size_t(Y-o.y)*ld+(X-o.x)*d,X,Y,W,H,d,ld);
+}
+
+//------------------------------------------------------------------------------
+
+Bounds Pixel_buffer::extent() const
+{
+    return Bounds(point(0).x,point(0).y,w,h);
 }
 
 //------------------------------------------------------------------------------
@@ -14,8 +14,15 @@
 #include <FL/fl_draw.H>
 #include <FL/Fl_Image.H>
 #include "Point.h"
+#include "Shape_index.h"
+#include "Thread_pool.h"
 #include "std_lib_facilities.h"
 #include <iostream>
+#include <algorithm>
+#include <deque>
+#include <queue>
+#include <set>
+#include <unordered_map>
 
 namespace Graph_lib {
 
@@ -116,6 +123,39 @@ private:
 
 //------------------------------------------------------------------------------
 
+// While a Render_state exists, Shape::draw() doesn't restore the color and line style
+// it found, and the calls below skip setting what is already set, so shapes drawn
+// one after the other with the same look cost no graphics state changes.
+// A draw_lines() should set color, line style and font through these calls.
+class Render_state {
+public:
+    Render_state();     // start of a frame
+    ~Render_state();    // back to the color, line style and font of the start of the frame
+
+    static bool tracking() { return 0<depth; }
+
+    static void color(Fl_Color c);
+    static void line_style(int style, int width);
+    static void font(Fl_Font f, Fl_Fontsize size);
+    static void frame_font();    // the font in effect at the start of the frame
+    static void frame_font(Fl_Font& f, Fl_Fontsize& size);    // which that is; outside a frame, the current font
+private:
+    static int depth;           // number of Render_states in existence
+    static bool style_known;    // line style set through line_style() this frame
+    static int cur_style, cur_width;
+    static Fl_Font base_font;
+    static Fl_Fontsize base_size;
+
+    Fl_Color oldc;
+    Fl_Font oldf;
+    Fl_Fontsize olds;
+
+    Render_state(const Render_state&);    // prevent copying
+    Render_state& operator=(const Render_state&);
+};
+
+//------------------------------------------------------------------------------
+
 template<class T> class Vector_ref {
     vector<T*> v;
     vector<T*> owned;
@@ -147,33 +187,78 @@ public:
 
 typedef double Fct(double);
 
+class Window;
+class Shape;
+
+// draw shapes in order, tracking the render state; if by_style, shapes whose
+// bboxes don't overlap may be drawn out of order, grouped by color and style
+void draw_all(const vector<Shape*>& shapes, bool by_style = false);
+
+// for the shape lists of Window and Offscreen, bottom first:
+bool remove_shape(vector<Shape*>& shapes, const Shape& s);    // false if s wasn't there
+bool raise_shape(vector<Shape*>& shapes, const Shape& s);     // move s to the top
+
 class Shape  {        // deals with color and style, and holds sequence of lines 
 public:
     void draw() const;                 // deal with color and draw lines
     virtual void move(int dx, int dy); // move the shape +=dx and +=dy
 
-    void set_color(Color col) { lcolor = col; }
+    void set_color(Color col) { lcolor = col; changed(); }
     Color color() const { return lcolor; }
-    void set_style(Line_style sty) { ls = sty; }
+    void set_style(Line_style sty) { ls = sty; changed(); }
     Line_style style() const { return ls; }
-    void set_fill_color(Color col) { fcolor = col; }
+    void set_fill_color(Color col) { fcolor = col; changed(); }
     Color fill_color() const { return fcolor; }
 
     Point point(int i) const { return points[i]; } // read only access to points
     int number_of_points() const { return int(points.size()); }
 
-    virtual ~Shape() { }
+    Bounds bbox() const                // the pixels draw() may touch
+    {
+        if (!box_known()) {    // computed once per change, or per driver, see measures_text()
+            box = extent();
+            box_ok = true;
+            box_drv = fl_graphics_driver;
+        }
+        return box;
+    }
+
+    virtual ~Shape();
 protected:
     Shape();    
     virtual void draw_lines() const;   // draw the appropriate lines
+    virtual Bounds extent() const;     // box around the points, widened by the line width
+    virtual Bounds point_extent(Point p) const;    // what p adds to extent(); override along with it
     void add(Point p);                 // add p to points
     void set_point(int i,Point p);     // points[i]=p;
+    void changed();                    // call after anything that alters what draw() does
+    void changed(Bounds part);         // only part (in window coordinates) looks different
+    void grown(Bounds more);           // all we drew is still drawn, and now also more
+    // extent() measures text, and fonts measure differently on the display and
+    // in an Offscreen: bbox() is then computed afresh when the driver changes
+    void measures_text() { by_font = true; }
+    int line_pad() const;              // how far a line reaches beyond its end points
+    void contain(Shape& part) { part.up = this; }    // part's changes are ours too
+    void release(Shape& part) { if (part.up==this) part.up = 0; }    // undo contain(part)
+    static bool contained(const Shape& s) { return s.up!=0; }    // s is part of some shape
+    virtual void part_changed(Shape&) { changed(); }    // a contain()ed part changed
 private:
     vector<Point> points;              // not used by all shapes
     Color lcolor;                      // color for lines and characters
     Line_style ls; 
     Color fcolor;                      // fill color
 
+    friend class Window;
+    Window* own;                       // the window we are attached to, if any
+    Bounds shown;                      // bbox() when own last drew us
+    Shape* up;                         // the shape we are part of, if any
+    mutable Bounds box;                // bbox() cache
+    mutable bool box_ok;               // box is up to date
+    bool by_font;                      // see measures_text()
+    mutable const Fl_Graphics_Driver* box_drv;    // the driver box was computed with
+
+    bool box_known() const { return box_ok && (!by_font || box_drv==fl_graphics_driver); }
+
     Shape(const Shape&);               // prevent copying
     Shape& operator=(const Shape&);
 };
@@ -181,13 +266,151 @@ private:
 //------------------------------------------------------------------------------
 
 struct Function : Shape {
+    // how to sample f adaptively: where the graph bends so much that the curve
+    // strays more than tolerance pixels from the straight line between two samples,
+    // put another sample between them; stop at budget points in all
+    struct Adaptive {
+        explicit Adaptive(double tol = 0.5, int max = 10000) : tolerance(tol), budget(max) { }
+        double tolerance;
+        int budget;
+    };
+
     // the function parameters are not stored
     Function(Fct f, double r1, double r2, Point orig,
         int count = 100, double xscale = 25, double yscale = 25);    
+    Function(Fct f, double r1, double r2, Point orig, Adaptive a,
+        int count = 16, double xscale = 25, double yscale = 25);
+
+    // the same for anything that can be called as f(x): a lambda, a function object, ...
+    template<class F> Function(F f, double r1, double r2, Point orig,
+        int count = 100, double xscale = 25, double yscale = 25)
+    { sample(f,r1,r2,orig,count,xscale,yscale,0); }
+    template<class F> Function(F f, double r1, double r2, Point orig, Adaptive a,
+        int count = 16, double xscale = 25, double yscale = 25)
+    { refine(f,r1,r2,orig,a,count,xscale,yscale); }
+
+    // compute the f(x) on pool, in chunks of x, for an f that takes long;
+    // f must be safe to call from several threads at once.
+    // The points are exactly those the serial constructors give
+    Function(Fct f, double r1, double r2, Point orig,
+        int count, double xscale, double yscale, Thread_pool& pool);
+    template<class F> Function(F f, double r1, double r2, Point orig,
+        int count, double xscale, double yscale, Thread_pool& pool)
+    { sample(f,r1,r2,orig,count,xscale,yscale,&pool); }
+
+private:
+    struct Sample {         // f(x), scaled to pixels
+        double x, sx, sy;
+        bool operator<(const Sample& s) const { return x<s.x; }
+    };
+    struct Piece {          // the graph between samples a and b, with m half way
+        Sample a, m, b;
+        double dev;         // distance in pixels from m to the line a-b
+        bool operator<(const Piece& p) const { return dev<p.dev; }
+    };
+
+    template<class F> void sample(F& f, double r1, double r2, Point xy,
+        int count, double xscale, double yscale, Thread_pool* pool);
+    template<class F> void refine(F& f, double r1, double r2, Point xy, Adaptive ad,
+        int count, double xscale, double yscale);
+    template<class F> static Sample at(F& f, double x, double xscale, double yscale);
+    template<class F> static Piece piece(F& f, const Sample& a, const Sample& b,
+        double xscale, double yscale);
 };
 
 //------------------------------------------------------------------------------
 
+template<class F> void Function::sample(F& f, double r1, double r2, Point xy,
+    int count, double xscale, double yscale, Thread_pool* pool)
+// graph f(x) for x in [r1:r2) using count line segments with (0,0) displayed at xy
+// x coordinates are scaled by xscale and y coordinates scaled by yscale
+{
+    if (r2-r1<=0) error("bad graphing range");
+    if (count <=0) error("non-positive graphing count");
+    vector<double> xs(count);
+    double dist = (r2-r1)/count;
+    double r = r1;
+    for (int i = 0; i<count; ++i) {    // serially, so that the x are always the same
+        xs[i] = r;
+        r += dist;
+    }
+
+    vector<double> ys(count);
+    if (pool) {
+        int chunks = min(count,4*(pool->size()+1));
+        pool->for_each(chunks,[&](int c) {
+            for (int i = int(double(count)*c/chunks); i<int(double(count)*(c+1)/chunks); ++i)
+                ys[i] = f(xs[i]);
+        });
+    }
+    else
+        for (int i = 0; i<count; ++i) ys[i] = f(xs[i]);
+
+    for (int i = 0; i<count; ++i)
+        add(Point(xy.x+int(xs[i]*xscale),xy.y-int(ys[i]*yscale)));
+}
+
+//------------------------------------------------------------------------------
+
+template<class F> Function::Sample Function::at(F& f, double x, double xscale, double yscale)
+{
+    Sample s = { x, x*xscale, f(x)*yscale };
+    return s;
+}
+
+//------------------------------------------------------------------------------
+
+template<class F> Function::Piece Function::piece(F& f, const Sample& a, const Sample& b,
+    double xscale, double yscale)
+{
+    Piece p = { a, at(f,(a.x+b.x)/2,xscale,yscale), b, 0 };
+    double dx = b.sx-a.sx, dy = b.sy-a.sy;
+    if (1<=abs(dx))    // narrower than a pixel; splitting it can't show
+        p.dev = abs(dx*(p.m.sy-a.sy)-dy*(p.m.sx-a.sx))/sqrt(dx*dx+dy*dy);
+    return p;
+}
+
+//------------------------------------------------------------------------------
+
+template<class F> void Function::refine(F& f, double r1, double r2, Point xy, Adaptive ad,
+    int count, double xscale, double yscale)
+// graph f(x) for x in [r1:r2] starting with count line segments and splitting
+// the one that strays furthest from the curve until all are within ad.tolerance
+// pixels or ad.budget points are used; (0,0) is displayed at xy
+{
+    if (r2-r1<=0) error("bad graphing range");
+    if (count <=0) error("non-positive graphing count");
+    if (ad.budget<=count) error("graphing budget not above count");
+
+    vector<Sample> samples;
+    priority_queue<Piece> pieces;    // worst first
+    Sample prev = at(f,r1,xscale,yscale);
+    samples.push_back(prev);
+    for (int i = 1; i<=count; ++i) {
+        Sample s = at(f,i==count ? r2 : r1+(r2-r1)*i/count,xscale,yscale);
+        samples.push_back(s);
+        pieces.push(piece(f,prev,s,xscale,yscale));
+        prev = s;
+    }
+
+    while (!pieces.empty() && int(samples.size())<ad.budget) {
+        Piece p = pieces.top();
+        if (!(ad.tolerance<p.dev)) break;    // all good enough
+        pieces.pop();
+        samples.push_back(p.m);
+        pieces.push(piece(f,p.a,p.m,xscale,yscale));
+        pieces.push(piece(f,p.m,p.b,xscale,yscale));
+    }
+
+    sort(samples.begin(),samples.end());
+    for (unsigned int i = 0; i<samples.size(); ++i) {
+        Point p(xy.x+int(samples[i].sx),xy.y-int(samples[i].sy));
+        if (i==0 || p!=point(number_of_points()-1)) add(p);    // no use repeating a pixel
+    }
+}
+
+//------------------------------------------------------------------------------
+
 struct Line : Shape {            // a Line is a Shape defined by two Points
     Line(Point p1, Point p2);    // construct a line from two points
 };
@@ -208,6 +431,7 @@ struct Rectangle : Shape {
         if (h<=0 || w<=0) error("Bad rectangle: non-positive width or height");
     }
     void draw_lines() const;
+    Bounds extent() const;
 
     int height() const { return h; }
     int width() const { return w; }
@@ -218,6 +442,31 @@ private:
 
 //------------------------------------------------------------------------------
 
+// many filled rectangles ("cells") as one shape, e.g. a color palette or a heat map;
+// cells are filled a color at a time, so they should not overlap,
+// and are outlined in color() (set it to Color::invisible for no outlines)
+struct Rectangle_grid : Shape {
+    Rectangle_grid() : order_ok(false) { }
+
+    int add(Point xy, int ww, int hh, Color fill);    // add a cell; returns its index
+
+    void draw_lines() const;
+    Bounds extent() const;
+    void move(int dx, int dy);
+
+    int size() const { return int(xs.size()); }
+    Bounds cell(int i) const { return Bounds(xs[i],ys[i],ws[i],hs[i]); }
+    void set_cell_color(int i, Color c) { fills[i] = c; order_ok = false; changed(); }
+    Color cell_color(int i) const { return fills[i]; }
+private:
+    vector<int> xs, ys, ws, hs;    // one element per cell
+    vector<Color> fills;
+    mutable vector<int> order;     // visible cells grouped by fill color
+    mutable bool order_ok;
+};
+
+//------------------------------------------------------------------------------
+
 struct Square : Shape {
 	Square(Point xy, int area) : _area(area) 
 	{
@@ -226,6 +475,7 @@ struct Square : Shape {
 	}
 
 	void draw_lines() const;
+	Bounds extent() const;
 
 	int get_area() const { return _area; }
 	void set_area(int area);
@@ -236,8 +486,94 @@ private:
 //------------------------------------------------------------------------------
 
 struct Open_polyline : Shape {         // open sequence of lines
-    void add(Point p) { Shape::add(p); }
+    Open_polyline() : tol(0), keep_ok(false) { }
+
+    void add(Point p) { Shape::add(p); keep_ok = false; }
+    void draw_lines() const;
+
+    // draw only the points needed to stay within tolerance pixels of the
+    // line through all of them (worked out once, when next drawn); 0 draws all
+    void set_simplify(double tolerance) { tol = tolerance; keep_ok = false; changed(); }
+    double simplify() const { return tol; }
+protected:
+    const vector<int>& drawn() const;    // numbers of the points to draw
+private:
+    double tol;
+    mutable vector<int> keep;
+    mutable bool keep_ok;
+};
+
+//------------------------------------------------------------------------------
+
+// an open polyline of at most capacity points for live data: when it is full,
+// add() drops the oldest point. Both add() and move() take constant time:
+// move() moves the points already added, as for any Shape, but only by
+// changing an offset applied when drawing, so scroll with move(-dx,0)
+struct Stream_polyline : Shape {
+    explicit Stream_polyline(int capacity);
+
+    void add(Point p);
+    void move(int dx, int dy);
+
+    int size() const { return n; }
+    int capacity() const { return int(ring.size()); }
+    Point at(int i) const;    // where the i'th oldest point is drawn
+
+    // the points are in the ring, not in Shape's points
+    int number_of_points() const { return n; }
+    Point point(int i) const { return at(i); }
+
+    void draw_lines() const;
+    Bounds extent() const;
+private:
+    vector<Point> ring;
+    int first;              // the oldest point
+    int n;                  // number of points in ring
+    long long added;        // number of points ever added
+    Point off;              // the ring holds each point less off
+
+    // the extremes of the points in ring: the values of points
+    // added later that are no less extreme, from oldest to newest
+    struct Extreme { long long seq; int v; };
+    deque<Extreme> x_lo, x_hi, y_lo, y_hi;
+    void keep(deque<Extreme>& d, int v, bool lo);
+};
+
+//------------------------------------------------------------------------------
+
+// a graph of (x,y) samples, x never decreasing, in a w*h box with top left corner xy:
+// x in [x0:x1) is spread over the w pixel columns, y in [y0:y1] over the h rows.
+// However many samples fall in a pixel column, only the first, the lowest, the highest
+// and the last of them are drawn: the lines between them cover the same pixels
+// as the lines between all of them would.
+struct Time_series : Shape {
+    Time_series(Point xy, int ww, int hh, double xx0, double xx1, double yy0, double yy1);
+
+    void add(double x, double y);
+    int size() const { return int(xs.size()); }
+
+    void set_x_range(double xx0, double xx1);
+    void set_y_range(double yy0, double yy1);
+    void set_width(int ww);
+
+    Point screen(int i) const;    // where sample i is drawn
+
     void draw_lines() const;
+    Bounds extent() const;
+private:
+    vector<double> xs, ys;
+    int w, h;
+    double x0, x1, y0, y1;
+
+    struct Column { int col, first, low, high, last; };    // sample numbers
+    mutable vector<Column> cols;    // the visible pixel columns with samples in them
+    mutable int before;             // the last sample left of the columns, or -1
+    mutable int after;              // the first sample right of the columns, or -1
+    mutable int folded;             // samples accounted for in cols, before and after
+
+    double column(double x) const { return (x-x0)*w/(x1-x0); }
+    void reset() const { cols.clear(); before = after = -1; folded = 0; }
+    void fold() const;              // account for samples added since the last draw
 };
 
 //------------------------------------------------------------------------------
@@ -248,9 +584,41 @@ struct Closed_polyline : Open_polyline { // closed sequence of lines
 
 //------------------------------------------------------------------------------
 
+// a uniform grid over line segments, for finding those that may cross a given one
+// without looking at all of them
+class Edge_grid {
+public:
+    Edge_grid() : cs(0), n(0) { }
+
+    void clear(int cell_size);
+    void insert(int i, Point a, Point b);    // segment number i from a to b
+    // numbers of the segments sharing a cell with a-b's box, each once, in order:
+    void candidates(Point a, Point b, vector<int>& res) const;
+
+    int size() const { return n; }           // segments inserted
+    bool empty() const { return cs==0; }     // cleared with no cell size yet
+private:
+    int cs;    // cell size in pixels
+    int n;
+    unordered_map<long long,vector<int> > cells;
+    mutable vector<long long> keys;    // scratch for cells_on()
+
+    void cells_on(Point a, Point b, vector<long long>& keys) const;
+};
+
+//------------------------------------------------------------------------------
+
 struct Polygon : Closed_polyline {    // closed sequence of non-intersecting lines
+    Polygon() : indexed(0) { }
+    Polygon(const vector<Point>& ps);    // much faster than add()ing the points one by one
+
     void add(Point p);
     void draw_lines() const;
+private:
+    Edge_grid edges;    // the edges, relative to point(0), once there are many
+    int indexed;        // number of edges when edges was last rebuilt
+
+    void index_edges();
 };
 
 //------------------------------------------------------------------------------
@@ -265,23 +633,93 @@ struct Lines : Shape {                 // related lines
 //------------------------------------------------------------------------------
 
 struct Text : Shape {
-    // the point is the bottom left of the first letter
-    Text(Point x, const string& s) : lab(s), fnt(fl_font()), fnt_sz(fl_size()) { add(x); }
+    // the point is the bottom left of the first letter;
+    // a '\n' in the label starts a new line below
+    Text(Point x, const string& s)
+        : lab(s), fnt(fl_font()), fnt_sz(fl_size()), wrap(0), lay_ok(false), lay_drv(0)
+    { measures_text(); add(x); }
 
     void draw_lines() const;
+    Bounds extent() const;
+    void draw_at(Point p) const;    // draw the lines as if point(0) were p
 
-    void set_label(const string& s) { lab = s; }
+    void set_label(const string& s) { lab = s; relayout(); }
     string label() const { return lab; }
 
-    void set_font(Font f) { fnt = f; }
+    void set_font(Font f) { fnt = f; relayout(); }
     Font font() const { return Font(fnt); }
 
-    void set_font_size(int s) { fnt_sz = s; }
+    void set_font_size(int s) { fnt_sz = s; relayout(); }
     int font_size() const { return fnt_sz; }
+
+    // also break lines at spaces to keep them within w pixels; 0 for not
+    void set_wrap(int w) { wrap = w; relayout(); }
+    int wrap_width() const { return wrap; }
 private:
     string lab;    // label
     Font fnt;
     int fnt_sz;
+    int wrap;
+
+    // the layout, measured once per change of label or font, and again
+    // when drawn or measured by another graphics driver than before
+    struct Line { int first, n; };    // lab[first] to lab[first+n-1]
+    mutable vector<Line> lines;
+    mutable int lw, lh, ld;           // widest line, line height, descent
+    mutable bool lay_ok;
+    mutable const Fl_Graphics_Driver* lay_drv;    // the driver that measured it
+
+    void relayout() { lay_ok = false; changed(); }
+    void lay_out() const;
+};
+
+//------------------------------------------------------------------------------
+
+// many Text labels, of which only those not overlapping a more important one
+// are drawn: a label that collides is tried left of and below its point, and
+// left out if it collides there too. Attach the Labels, not the Texts, which
+// must outlive it. A higher priority wins; for equal priorities, the label
+// added first. When labels move, only the labels around them are placed again.
+struct Labels : Shape {
+    Labels() : order(0), at_drv(0) { measures_text(); }
+    ~Labels();
+
+    void add(Text& t, int priority = 0);
+    void draw_lines() const;
+    Bounds extent() const;
+
+    int number_of_labels() const { return int(entries.size()); }
+    int number_placed() const { bbox(); return placed.size(); }
+    bool is_placed(const Text& t) const;
+protected:
+    void part_changed(Shape& part);
+private:
+    struct Entry {
+        Text* t;
+        int priority;
+        int order;       // for equal priorities
+        Bounds home;     // t->bbox() when last placed; measured when first placed
+        int at;          // the place chosen, or -1 if left out
+        bool queued;     // in fresh
+        bool moved;      // in moved
+    };
+    int order;
+    mutable vector<Entry> entries;
+    std::unordered_map<const Shape*,int> which;    // Text to entry
+    mutable Shape_index placed;     // where placed labels are drawn
+    mutable Shape_index dropped;    // where left out labels could go
+    mutable vector<int> fresh;      // entries to place
+    mutable vector<int> moved;      // entries whose Text changed since
+    mutable std::multiset<int> x0s, y0s, x1s, y1s;    // edges of the placed labels: extent()
+    mutable const Fl_Graphics_Driver* at_drv;         // the driver the placement was measured by
+
+    static const int places = 4;
+    static Bounds place(const Entry& e, int i);    // e drawn at its i-th place
+    static Bounds reach(const Entry& e);           // all of e's places
+    bool outranks(int a, int b) const;
+    void put(const Entry& e) const;     // into placed
+    void take(const Entry& e) const;    // out of placed
+    void update() const;
 };
 
 //------------------------------------------------------------------------------
@@ -292,6 +730,7 @@ struct Axis : Shape {
         int number_of_notches=0, string label = "");
 
     void draw_lines() const;
+    Bounds extent() const;
     void move(int dx, int dy);
     void set_color(Color c);
 
@@ -301,16 +740,37 @@ struct Axis : Shape {
 
 //------------------------------------------------------------------------------
 
+// a shape's outline as straight pieces, relative to its point(0), so that it
+// is computed when the shape changes size rather than on every draw, and
+// drawn with one polygon or one line instead of many arc and pie calls
+struct Outline {
+    void clear() { xy.clear(); }
+    bool empty() const { return xy.empty(); }
+    void add(double x, double y) { xy.push_back(x); xy.push_back(y); }
+    // the part of the ellipse in box x,y,w,h from angle a1 to a2 (degrees,
+    // counterclockwise from 3 o'clock), as fl_arc() draws it
+    void arc(double x, double y, double w, double h, double a1, double a2);
+
+    void draw_line(Point o, bool closed) const;    // fl_line_style() applies
+    void draw_fill(Point o, bool convex = true) const;    // convex: as fl_begin_polygon() needs
+private:
+    vector<double> xy;    // x0,y0, x1,y1, ...
+};
+
+//------------------------------------------------------------------------------
+
 struct Circle : Shape {
     Circle(Point p, int rr);    // center and radius
 
     void draw_lines() const;
+    Bounds extent() const;
 
     Point center() const ; 
     int radius() const { return r; }
-    void set_radius(int rr) { r=rr; }
+    void set_radius(int rr) { r=rr; edge.clear(); changed(); }
 private:
     int r;
+    mutable Outline edge;
 };
 
 //------------------------------------------------------------------------------
@@ -323,18 +783,20 @@ struct Ellipse : Shape {
     }
 
     void draw_lines() const;
+    Bounds extent() const;
 
     Point center() const { return Point(point(0).x+w,point(0).y+h); }
     Point focus1() const { return Point(center().x+int(sqrt(double(w*w-h*h))),center().y); }
     Point focus2() const { return Point(center().x-int(sqrt(double(w*w-h*h))),center().y); }
 
-    void set_major(int ww) { w=ww; }
+    void set_major(int ww) { w=ww; edge.clear(); changed(); }
     int major() const { return w; }
-    void set_minor(int hh) { h=hh; }
+    void set_minor(int hh) { h=hh; edge.clear(); changed(); }
     int minor() const { return h; }
 private:
     int w;
     int h;
+    mutable Outline edge;
 };
 
 //------------------------------------------------------------------------------
@@ -347,22 +809,26 @@ struct Arc : Shape {
 	}
 
 	void draw_lines() const;
+	Bounds extent() const;
 
 	Point center() const { return Point{ point(0).x + w,point(0).y + h }; } // returns center point of arc
 
-	void set_width(int ww) { w = ww; }
+	void set_width(int ww) { w = ww; reshape(); }
 	int width() { return w; }
-	void set_height(int hh) { h = hh; }
+	void set_height(int hh) { h = hh; reshape(); }
 	int height() { return h; }
 
-	void set_angle1(int a) { a1 = a; }
-	void set_angle2(int a) { a2 = a; }
+	void set_angle1(int a) { a1 = a; reshape(); }
+	void set_angle2(int a) { a2 = a; reshape(); }
 	void set_angles(int a, int b);
 private:
 	int w;
 	int h;
 	int a1;
 	int a2;
+	mutable Outline edge, pie;
+
+	void reshape() { edge.clear(); pie.clear(); changed(); }
 };
 
 //------------------------------------------------------------------------------
@@ -371,6 +837,7 @@ struct Rounded_Rect : Shape {
 	Rounded_Rect(Point xy, int w, int h);
 
 	void draw_lines() const;
+	Bounds extent() const;
 
 	int get_width() const { return width; }
 	void set_width(int w);
@@ -380,6 +847,7 @@ private:
 	int width;
 	int height;
 	int radius;
+	mutable Outline edge;
 };
 
 //------------------------------------------------------------------------------
@@ -389,12 +857,14 @@ struct Rounded_Square : Shape {
 	Rounded_Square(Point xy, int area);
 
 	void draw_lines() const;
+	Bounds extent() const;
 
 	int get_area() const { return area; }
 	void set_area(int a);
 private:
 	int area;
 	int radius;
+	mutable Outline edge;
 };
 
 //------------------------------------------------------------------------------
@@ -402,13 +872,16 @@ private:
 struct Arrow : Line {
 	Arrow(Point p1, Point p2) : Line(p1, p2) { }
 	void draw_lines() const;
+	Bounds extent() const;
 };
 
 //------------------------------------------------------------------------------
 
 struct Marked_polyline : Open_polyline {
-    Marked_polyline(const string& m) :mark(m) { }
+    Marked_polyline(const string& m) :mark(m) { measures_text(); }
     void draw_lines() const;
+    Bounds extent() const;
+    Bounds point_extent(Point p) const;
 private:
     string mark;
 };
@@ -433,24 +906,105 @@ struct Mark : Marks {
 
 //------------------------------------------------------------------------------
 
+// very many markers of one kind in one shape: a point costs its center, plus a
+// byte if points have sizes of their own, plus four if they have colors of
+// their own, rather than a whole Shape. Circles and squares are filled with
+// fill_color() if it is visible and outlined with color() if it is visible; a
+// point's own color, if given, replaces color() for its outline, cross or glyph.
+// Sizes are in pixels, 1 to 255.
+struct Scatter : Shape {
+    enum Kind { circle, square, cross, glyph };
+
+    explicit Scatter(Kind k = circle, int size = 6);
+    explicit Scatter(char mark);    // glyph: mark drawn like a Mark's
+    Scatter(const vector<Point>& centers, Kind k = circle, int size = 6);
+
+    void draw_lines() const;
+    Bounds extent() const;
+    void move(int dx, int dy);
+
+    void add(Point p);
+    void add(Point p, int size);
+    void add(Point p, int size, Color c);
+
+    void set_center(int i, Point p);
+    void set_size(int i, int size);
+    void set_marker_color(int i, Color c);
+
+    int number_of_markers() const { return int(at.size()); }
+    Point center(int i) const { return at[i]; }
+    int size(int i) const { return sz.empty() ? msize : sz[i]; }
+private:
+    Kind kind;
+    char mark;
+    int msize;                    // for points without a size of their own
+    vector<Point> at;
+    vector<unsigned char> sz;     // empty until some point has a size of its own
+    vector<Fl_Color> cols;        // empty until some point has a color of its own
+    int biggest;                  // largest size in use
+    mutable vector<Outline> rings;    // circle outlines by size, made when first drawn
+
+    void append(Point p, int size, Fl_Color c, bool own_size, bool own_color);
+    Bounds marker(Point p, int s) const;    // the pixels the marker at p may touch
+    const Outline& ring(int s) const;
+    void moved(int i, Bounds was);
+    void draw_pass(int x0, int y0, int x1, int y1, bool fill, bool line) const;
+};
+
+//------------------------------------------------------------------------------
+
 struct Suffix {
-    enum Encoding { none, jpg, gif  };
+    enum Encoding { none, jpg, gif, png, bmp, pnm };
 };
 
 Suffix::Encoding get_encoding(const string& s);
 
 //------------------------------------------------------------------------------
 
+// when an Image is decoded: now, in the constructor, or later, on
+// Thread_pool::shared() while the Image shows a Loading_image
+struct Load {
+    enum Mode { now, later };
+};
+
 struct Image : Shape {
-    Image(Point xy, string file_name, Suffix::Encoding e = Suffix::none);
-    ~Image() { delete p; }
+    Image(Point xy, string file_name, Suffix::Encoding e = Suffix::none,
+          Load::Mode m = Load::now);
+    // shown fitted into a ww by hh box, keeping only about as many pixels as that
+    Image(Point xy, string file_name, int ww, int hh, Suffix::Encoding e = Suffix::none,
+          Load::Mode m = Load::now);
+    ~Image();
     void draw_lines() const;
-    void set_mask(Point xy, int ww, int hh) { w=ww; h=hh; cx=xy.x; cy=xy.y; }
+    Bounds extent() const;
+    void set_mask(Point xy, int ww, int hh) { w=ww; h=hh; cx=xy.x; cy=xy.y; changed(); }
+    void set_size(int ww, int hh);    // fit into ww by hh; 0,0 for the file's own size
+    bool loading() const { return pending!=0; }
+
+    // for images much bigger than the window: draw in t by t tiles, only those
+    // in view, and let go of tiles far from the view; 0 to draw the image whole
+    void set_tiled(int t = 256) { drop_tiles(); tile = t; changed(); }
 private:
+    struct Pending;
     int w,h;  // define "masking box" within image relative to position (cx,cy)
     int cx,cy; 
+    int sw,sh;    // the box to fit into, or 0,0
+    string file;
+    Suffix::Encoding enc;
     Fl_Image* p;
+    Fl_Image* fit;    // p resized to fit sw by sh, if p doesn't already
+    bool cached;    // p belongs to Image_cache::shared()
+    Pending* pending;    // the decode under way for Load::later, if any
     Text fn;
+    int tile;    // tile size, or 0
+    mutable vector<Fl_RGB_Image*> tiles;    // views of shown()'s pixels, made when first in view
+
+    void load(Load::Mode m);
+    void failed();
+    void refit();
+    void draw_tiles() const;
+    void drop_tiles() const;
+    Fl_Image* shown() const { return fit ? fit : p; }
+    static void loaded(void* v);
 };
 
 //------------------------------------------------------------------------------
@@ -462,6 +1016,41 @@ struct Bad_image : Fl_Image {
 
 //------------------------------------------------------------------------------
 
+struct Loading_image : Fl_Image {    // stands in for an image not yet decoded
+    Loading_image(int h, int w) : Fl_Image(h,w,0) { }
+    void draw(int x,int y, int, int, int, int)
+    {
+        fl_color(FL_GRAY);
+        fl_rect(x,y,w(),h());
+    }
+};
+
+//------------------------------------------------------------------------------
+
+// pixels that the caller owns and keeps up to date (camera frames, heat maps),
+// drawn straight from the caller's buffer: nothing is copied, so buf must
+// outlive the Pixel_buffer. A pixel is d bytes (1: gray, 3: RGB); a row starts
+// stride bytes after the one above (0: w*d). Call update() after changing
+// pixels so that just those are repainted.
+struct Pixel_buffer : Shape {
+    Pixel_buffer(Point xy, const unsigned char* buf, int ww, int hh, int dd = 3, int stride = 0);
+
+    void draw_lines() const;
+    Bounds extent() const;
+
+    void set_buffer(const unsigned char* buf, int ww, int hh, int dd = 3, int stride = 0);
+    void update() { changed(); }                      // every pixel may have changed
+    void update(int x, int y, int ww, int hh);        // pixels x..x+ww-1, y..y+hh-1 have
+
+    int width() const { return w; }
+    int height() const { return h; }
+private:
+    const unsigned char* pix;
+    int w, h, d, ld;
+};
+
+//------------------------------------------------------------------------------
+
 } // of namespace Graph_lib
 
 #endif
\ No newline at end of file
@@ -0,0 +1,453 @@
+
+//
+// This is a GUI support code to the chapters 12-16 of the book
+// "Programming -- Principles and Practice Using C++" by Bjarne Stroustrup
+//
+
+#include <cctype>
+#include <cstring>
+#include <sys/stat.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+#include <FL/Fl_BMP_Image.H>
+#include <FL/Fl_GIF_Image.H>
+#include <FL/Fl_JPEG_Image.H>
+#include <FL/Fl_PNG_Image.H>
+#include <FL/Fl_PNM_Image.H>
+#include "Image_cache.h"
+
+//------------------------------------------------------------------------------
+
+namespace Graph_lib {
+
+//------------------------------------------------------------------------------
+
+// the bytes of a file, mapped into memory rather than read into a buffer
+class File_map {
+public:
+    explicit File_map(const string& name);
+    ~File_map();
+    const unsigned char* data() const { return p; }    // 0 if the file can't be read
+    size_t size() const { return n; }
+private:
+    const unsigned char* p;
+    size_t n;
+#ifdef _WIN32
+    HANDLE file, map;
+#endif
+
+    File_map(const File_map&);    // prevent copying
+    File_map& operator=(const File_map&);
+};
+
+//------------------------------------------------------------------------------
+
+#ifdef _WIN32
+
+File_map::File_map(const string& name)
+    : p(0), n(0), map(0)
+{
+    file = CreateFileA(name.c_str(),GENERIC_READ,FILE_SHARE_READ,0,OPEN_EXISTING,0,0);
+    if (file==INVALID_HANDLE_VALUE) return;
+    LARGE_INTEGER sz;
+    if (!GetFileSizeEx(file,&sz) || sz.QuadPart==0) return;
+    map = CreateFileMappingA(file,0,PAGE_READONLY,0,0,0);
+    if (!map) return;
+    p = (const unsigned char*)MapViewOfFile(map,FILE_MAP_READ,0,0,0);
+    if (p) n = size_t(sz.QuadPart);
+}
+
+File_map::~File_map()
+{
+    if (p) UnmapViewOfFile(p);
+    if (map) CloseHandle(map);
+    if (file!=INVALID_HANDLE_VALUE) CloseHandle(file);
+}
+
+#else
+
+File_map::File_map(const string& name)
+    : p(0), n(0)
+{
+    int fd = open(name.c_str(),O_RDONLY);
+    if (fd<0) return;
+    struct stat st;
+    if (fstat(fd,&st)==0 && 0<st.st_size) {
+        void* m = mmap(0,st.st_size,PROT_READ,MAP_PRIVATE,fd,0);
+        if (m!=MAP_FAILED) {
+            p = (const unsigned char*)m;
+            n = st.st_size;
+        }
+    }
+    close(fd);    // the mapping stays valid
+}
+
+File_map::~File_map()
+{
+    if (p) munmap((void*)p,n);
+}
+
+#endif
+
+//------------------------------------------------------------------------------
+
+Suffix::Encoding sniff_encoding(const unsigned char* b, size_t n)
+{
+    if (3<=n && b[0]==0xFF && b[1]==0xD8 && b[2]==0xFF) return Suffix::jpg;
+    if (6<=n && memcmp(b,"GIF8",4)==0 && (b[4]=='7' || b[4]=='9') && b[5]=='a')
+        return Suffix::gif;
+    if (8<=n && memcmp(b,"\x89PNG\r\n\x1a\n",8)==0) return Suffix::png;
+    if (2<=n && b[0]=='B' && b[1]=='M') return Suffix::bmp;
+    if (3<=n && b[0]=='P' && '1'<=b[1] && b[1]<='6' && isspace(b[2])) return Suffix::pnm;
+    return Suffix::none;
+}
+
+//------------------------------------------------------------------------------
+
+Fl_Image* decode_image(const string& name, Suffix::Encoding e)
+{
+    File_map f(name);    // the one time the file is opened for PNG
+    if (!f.data()) return 0;
+    Suffix::Encoding c = sniff_encoding(f.data(),f.size());    // the bytes know best
+    if (c != Suffix::none) e = c;
+    else if (e == Suffix::none) e = get_encoding(name);
+
+    // FLTK reads only PNG from memory knowing where the bytes end; reading JPEG
+    // from memory it doesn't, so a damaged JPEG would be read past the end of f.
+    // The others open the file themselves
+    Fl_Image* img = 0;
+    switch(e) {        // check if it is a known encoding
+    case Suffix::jpg:
+        img = new Fl_JPEG_Image(name.c_str());
+        break;
+    case Suffix::png:
+        img = new Fl_PNG_Image(name.c_str(),f.data(),int(f.size()));
+        break;
+    case Suffix::gif:
+        img = new Fl_GIF_Image(name.c_str());
+        break;
+    case Suffix::bmp:
+        img = new Fl_BMP_Image(name.c_str());
+        break;
+    case Suffix::pnm:
+        img = new Fl_PNM_Image(name.c_str());
+        break;
+    default:    // Unsupported image encoding
+        return 0;
+    }
+    if (img->fail()) {    // not what it claimed to be, or damaged
+        delete img;
+        return 0;
+    }
+    return img;
+}
+
+//------------------------------------------------------------------------------
+
+Fl_Image* shrink_image(Fl_Image* img, int k)
+{
+    if (k<=0) return img->copy();
+    if (img->d()==0) {    // a pixmap (GIF): average its colors
+        if (Fl_Pixmap* pm = dynamic_cast<Fl_Pixmap*>(img)) {
+            Fl_RGB_Image rgb(pm);
+            return shrink_image(&rgb,k);
+        }
+        return img->copy(max(1,img->w()>>k),max(1,img->h()>>k));
+    }
+
+    const int f = 1<<k;
+    const int w = img->w(), h = img->h(), d = img->d();
+    const int nw = (w+f-1)/f, nh = (h+f-1)/f;
+    const int ld = img->ld() ? img->ld() : w*d;
+    const uchar* src = (const uchar*)img->data()[0];
+    uchar* dst = new uchar[size_t(nw)*nh*d];
+    vector<unsigned> sum(nw*d);    // for one row of the result
+    for (int y=0; y<nh; ++y) {
+        fill(sum.begin(),sum.end(),0u);
+        const int y0 = y*f, y1 = min(h,y0+f);
+        for (int yy=y0; yy<y1; ++yy) {
+            const uchar* row = src+size_t(yy)*ld;
+            for (int x=0; x<w; ++x)
+                for (int c=0; c<d; ++c) sum[(x>>k)*d+c] += row[x*d+c];
+        }
+        uchar* out = dst+size_t(y)*nw*d;
+        for (int x=0; x<nw; ++x) {
+            const unsigned n = (min(w,(x+1)*f)-x*f)*(y1-y0);    // pixels in this block
+            for (int c=0; c<d; ++c) out[x*d+c] = uchar((sum[x*d+c]+n/2)/n);
+        }
+    }
+    Fl_RGB_Image* r = new Fl_RGB_Image(dst,nw,nh,d);
+    r->alloc_array = 1;
+    return r;
+}
+
+//------------------------------------------------------------------------------
+
+inline size_t image_bytes(Fl_Image* img)    // pixmaps: guess 4 bytes per pixel
+{
+    return size_t(img->w())*img->h()*(0<img->d() ? img->d() : 4);
+}
+
+//------------------------------------------------------------------------------
+
+const int max_level = 8;    // 1/256: a level past that would hardly save anything
+
+// the coarsest level of a w by h image that still has the pixels
+// to show it fitted into a ww by hh box
+inline int fit_level(int w, int h, int ww, int hh)
+{
+    if (w<=0 || h<=0 || ww<=0 || hh<=0) return 0;
+    const double scale = min(double(ww)/w,double(hh)/h);
+    int k = 0;
+    while (k<max_level && w*scale<=(w>>(k+1)) && h*scale<=(h>>(k+1))) ++k;
+    return k;
+}
+
+//------------------------------------------------------------------------------
+
+Image_cache& Image_cache::shared()
+{
+    // never destroyed, so that Images destroyed at exit can still release()
+    static Image_cache* c = new Image_cache;
+    return *c;
+}
+
+//------------------------------------------------------------------------------
+
+Image_cache::Image_cache(size_t budget)
+    : limit(budget), total(0)
+{
+}
+
+//------------------------------------------------------------------------------
+
+Image_cache::~Image_cache()
+{
+    for (std::map<Fl_Image*,Entry>::iterator p = entries.begin(); p!=entries.end(); ++p)
+        delete p->first;
+    for (unsigned int i=0; i<dead.size(); ++i) delete dead[i];
+}
+
+//------------------------------------------------------------------------------
+
+static thread_local int workers = 0;    // Workers alive on this thread
+
+Image_cache::Worker::Worker() { ++workers; }
+Image_cache::Worker::~Worker() { --workers; }
+
+//------------------------------------------------------------------------------
+
+void Image_cache::collect()
+{
+    if (workers) return;    // not the GUI thread
+    vector<Fl_Image*> d;
+    {
+        std::lock_guard<std::mutex> lock(m);
+        d.swap(dead);
+    }
+    for (unsigned int i=0; i<d.size(); ++i) delete d[i];
+}
+
+//------------------------------------------------------------------------------
+
+Fl_Image* Image_cache::find(const Key& k, time_t mtime)
+// the current image for k, used once more, or 0
+{
+    std::map<Key,Fl_Image*>::iterator p = by_name.find(k);
+    if (p==by_name.end()) return 0;
+    Fl_Image* img = p->second;
+    Entry& en = entries[img];
+    if (en.mtime==mtime) {    // made already
+        if (en.refs++==0) unused.erase(en.idle);
+        return img;
+    }
+    // the file has changed: users keep the old image until they release it
+    by_name.erase(p);
+    en.current = false;
+    if (en.refs==0) {
+        unused.erase(en.idle);
+        erase(img);
+    }
+    return 0;
+}
+
+//------------------------------------------------------------------------------
+
+Fl_Image* Image_cache::insert(const Key& k, time_t mtime, Fl_Image* img)
+// enter img, used once, for k; the lock must be held
+{
+    if (Fl_Image* done = find(k,mtime)) {    // someone else was quicker
+        delete img;    // never drawn, so any thread may delete it
+        return done;
+    }
+    Entry en;
+    en.name = k.first;
+    en.level = k.second;
+    en.mtime = mtime;
+    en.size = image_bytes(img);
+    en.refs = 1;
+    en.current = true;
+    entries[img] = en;
+    by_name[k] = img;
+    total += en.size;
+    trim();
+    return img;
+}
+
+//------------------------------------------------------------------------------
+
+Fl_Image* Image_cache::get(const string& name, Suffix::Encoding e)
+{
+    collect();
+    struct stat st;
+    if (stat(name.c_str(),&st)!=0) return 0;
+    return get(name,e,0,st.st_mtime);
+}
+
+//------------------------------------------------------------------------------
+
+Fl_Image* Image_cache::get(const string& name, Suffix::Encoding e, int ww, int hh)
+{
+    collect();
+    struct stat st;
+    if (stat(name.c_str(),&st)!=0) return 0;
+
+    Source src;
+    bool known;
+    {
+        std::lock_guard<std::mutex> lock(m);
+        std::map<string,Source>::iterator p = sources.find(name);
+        known = p!=sources.end() && p->second.mtime==st.st_mtime;
+        if (known) src = p->second;
+    }
+    if (known) return get(name,e,fit_level(src.w,src.h,ww,hh),st.st_mtime);
+
+    // we have to decode the file to learn its size; the level we want is
+    // then made from that rather than by decoding once more, and only it is kept
+    Fl_Image* full = decode(name,e,st.st_mtime);
+    if (!full) return 0;
+    const int k = fit_level(full->w(),full->h(),ww,hh);
+    Fl_Image* img = full;
+    if (k) {
+        img = shrink_image(full,k);
+        delete full;
+    }
+    std::lock_guard<std::mutex> lock(m);
+    return insert(Key(name,k),st.st_mtime,img);
+}
+
+//------------------------------------------------------------------------------
+
+Fl_Image* Image_cache::decode(const string& name, Suffix::Encoding e, time_t mtime)
+// decode the file and note its size; the lock must not be held
+{
+    Fl_Image* full = decode_image(name,e);
+    if (!full) return 0;
+    std::lock_guard<std::mutex> lock(m);
+    Source& src = sources[name];
+    src.mtime = mtime;
+    src.w = full->w();
+    src.h = full->h();
+    return full;
+}
+
+//------------------------------------------------------------------------------
+
+Fl_Image* Image_cache::get(const string& name, Suffix::Encoding e, int level, time_t mtime)
+{
+    Fl_Image* finer = 0;
+    int from = 0;
+    {
+        std::lock_guard<std::mutex> lock(m);
+        if (Fl_Image* img = find(Key(name,level),mtime)) return img;
+        for (int j=level-1; 0<=j && !finer; --j)    // the nearest finer level
+            if ((finer = find(Key(name,j),mtime))) from = j;
+    }
+
+    // making the image may take long: don't hold the lock
+    Fl_Image* img;
+    if (finer) {
+        img = shrink_image(finer,level-from);
+        release(finer);
+    }
+    else {
+        Fl_Image* full = decode(name,e,mtime);
+        if (!full) return 0;
+        if (level==0)
+            img = full;
+        else {
+            img = shrink_image(full,level);
+            delete full;    // we only want the reduced image kept around
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(m);
+    return insert(Key(name,level),mtime,img);
+}
+
+//------------------------------------------------------------------------------
+
+void Image_cache::release(Fl_Image* img)
+{
+    {
+        std::lock_guard<std::mutex> lock(m);
+        std::map<Fl_Image*,Entry>::iterator p = entries.find(img);
+        if (p==entries.end()) return;
+        Entry& en = p->second;
+        if (--en.refs) return;
+        if (!en.current)
+            erase(img);
+        else {
+            unused.push_front(img);
+            en.idle = unused.begin();
+            trim();
+        }
+    }
+    collect();
+}
+
+//------------------------------------------------------------------------------
+
+void Image_cache::set_budget(size_t b)
+{
+    {
+        std::lock_guard<std::mutex> lock(m);
+        limit = b;
+        trim();
+    }
+    collect();
+}
+
+//------------------------------------------------------------------------------
+
+void Image_cache::erase(Fl_Image* img)    // img must not be in unused
+{
+    std::map<Fl_Image*,Entry>::iterator p = entries.find(img);
+    if (p->second.current) by_name.erase(Key(p->second.name,p->second.level));
+    total -= p->second.size;
+    entries.erase(p);
+    if (workers)
+        dead.push_back(img);    // for the GUI thread to delete
+    else
+        delete img;
+}
+
+//------------------------------------------------------------------------------
+
+void Image_cache::trim()
+{
+    while (limit<total && !unused.empty()) {    // least recently released first
+        Fl_Image* img = unused.back();
+        unused.pop_back();
+        erase(img);
+    }
+}
+
+//------------------------------------------------------------------------------
+
+} // of namespace Graph_lib
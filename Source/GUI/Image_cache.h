@@ -0,0 +1,111 @@
+
+//
+// This is a GUI support code to the chapters 12-16 of the book
+// "Programming -- Principles and Practice Using C++" by Bjarne Stroustrup
+//
+
+#ifndef IMAGE_CACHE_GUARD
+#define IMAGE_CACHE_GUARD 1
+
+#include <ctime>
+#include <cstddef>
+#include <list>
+#include <map>
+#include <mutex>
+#include "Graph.h"
+
+namespace Graph_lib {
+
+//------------------------------------------------------------------------------
+
+// decoded images, shared by all the Images showing the same file:
+// an image is decoded once per file name and modification time and kept
+// while some Image uses it; after that it stays (most recently released first)
+// until the bytes of all cached images exceed budget().
+// Besides the file's own pixels (level 0) the cache keeps reduced copies:
+// level k is the image shrunk by 2^k each way. A level is made when first
+// asked for, from the nearest finer level still cached, else from the file.
+class Image_cache {
+public:
+    static Image_cache& shared();    // the one everybody uses
+
+    explicit Image_cache(size_t budget = 64*1024*1024);
+    ~Image_cache();
+
+    // the image decoded from file name as encoding e (none: guess from the name),
+    // or 0 if the file can't be read; call release() when done with it
+    Fl_Image* get(const string& name, Suffix::Encoding e = Suffix::none);
+
+    // the coarsest level that still holds enough pixels to show the image
+    // fitted into a ww by hh box; 0 if unknown
+    Fl_Image* get(const string& name, Suffix::Encoding e, int ww, int hh);
+
+    void release(Fl_Image* img);
+
+    void set_budget(size_t b);
+    size_t budget() const { return limit; }
+    size_t bytes() const { return total; }    // in all cached images, used or not
+
+    // deleting an image that has been drawn frees display resources, which
+    // only the GUI thread may do. Put a Worker on the stack of any other thread
+    // before it uses a cache: the images it drops are then left to be deleted
+    // by the next call made without a Worker, or by collect().
+    struct Worker {
+        Worker();
+        ~Worker();
+    };
+    void collect();    // delete the images Workers dropped; on the GUI thread
+
+private:
+    struct Entry {
+        string name;
+        int level;
+        time_t mtime;
+        size_t size;
+        int refs;
+        bool current;                    // still the image for name and level
+        list<Fl_Image*>::iterator idle;  // place in unused, if refs==0
+    };
+
+    struct Source {    // what we know of a file without decoding it again
+        time_t mtime;
+        int w, h;
+    };
+    typedef std::pair<string,int> Key;    // name and level
+
+    std::map<Fl_Image*,Entry> entries;
+    std::map<Key,Fl_Image*> by_name;
+    std::map<string,Source> sources;
+    list<Fl_Image*> unused;    // most recently released first
+    vector<Fl_Image*> dead;    // dropped by Workers, to be deleted
+    size_t limit;
+    size_t total;
+    mutable std::mutex m;
+
+    Fl_Image* get(const string& name, Suffix::Encoding e, int level, time_t mtime);
+    Fl_Image* decode(const string& name, Suffix::Encoding e, time_t mtime);
+    Fl_Image* find(const Key& k, time_t mtime);
+    Fl_Image* insert(const Key& k, time_t mtime, Fl_Image* img);
+    void erase(Fl_Image* img);
+    void trim();    // drop unused images until within budget
+
+    Image_cache(const Image_cache&);    // prevent copying
+    Image_cache& operator=(const Image_cache&);
+};
+
+//------------------------------------------------------------------------------
+
+// decode file name, whose format is told by its first bytes, else by e, else
+// by its name; 0 if it can't be read or isn't in a format we know
+Fl_Image* decode_image(const string& name, Suffix::Encoding e);
+
+Suffix::Encoding sniff_encoding(const unsigned char* b, size_t n);    // none if unknown
+
+// a new image of img shrunk by 2^k each way, each pixel the average of those it covers
+Fl_Image* shrink_image(Fl_Image* img, int k);
+
+//------------------------------------------------------------------------------
+
+} // of namespace Graph_lib
+
+#endif // IMAGE_CACHE_GUARD
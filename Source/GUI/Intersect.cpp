@@ -0,0 +1,157 @@
+
+//
+// This is a GUI support code to the chapters 12-16 of the book
+// "Programming -- Principles and Practice Using C++" by Bjarne Stroustrup
+//
+
+#include "Intersect.h"
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && 2<=_M_IX86_FP)
+#include <emmintrin.h>
+#define INTERSECT_SSE2 1
+#endif
+
+//------------------------------------------------------------------------------
+
+namespace Graph_lib {
+
+//------------------------------------------------------------------------------
+
+// does two lines (p1,p2) and (p3,p4) intersect?
+// if se return the distance of the intersect point as distances from p1
+pair<double,double> line_intersect(Point p1, Point p2, Point p3, Point p4, bool& parallel) 
+{
+    double x1 = p1.x;
+    double x2 = p2.x;
+    double x3 = p3.x;
+    double x4 = p4.x;
+    double y1 = p1.y;
+    double y2 = p2.y;
+    double y3 = p3.y;
+    double y4 = p4.y;
+
+    double denom = ((y4 - y3)*(x2-x1) - (x4-x3)*(y2-y1));
+    if (denom == 0){
+        parallel= true;
+        return pair<double,double>(0,0);
+    }
+    parallel = false;
+    return pair<double,double>( ((x4-x3)*(y1-y3) - (y4-y3)*(x1-x3))/denom,
+                                ((x2-x1)*(y1-y3) - (y2-y1)*(x1-x3))/denom);
+}
+
+//------------------------------------------------------------------------------
+
+//intersection between two line segments
+//Returns true if the two segments intersect,
+//in which case intersection is set to the point of intersection
+bool line_segment_intersect(Point p1, Point p2, Point p3, Point p4, Point& intersection){
+   bool parallel;
+   pair<double,double> u = line_intersect(p1,p2,p3,p4,parallel);
+   if (parallel || u.first < 0 || u.first > 1 || u.second < 0 || u.second > 1) return false;
+   intersection.x = p1.x + u.first*(p2.x - p1.x);
+   intersection.y = p1.y + u.first*(p2.y - p1.y);
+   return true;
+}
+
+//------------------------------------------------------------------------------
+
+
+void Segments::add(Point a, Point b)
+{
+    ax.push_back(a.x);
+    ay.push_back(a.y);
+    bx.push_back(b.x);
+    by.push_back(b.y);
+}
+
+//------------------------------------------------------------------------------
+
+int segment_intersect(Point a, Point b, const Segments& s, int first, int last,
+                      vector<char>& hit, vector<double>& t)
+// the arithmetic is that of line_intersect(), a few segments at a time
+{
+    if (first<0 || s.size()<last) error("segment_intersect: bad range");
+    if (int(hit.size())<s.size()) hit.resize(s.size());
+    if (int(t.size())<s.size()) t.resize(s.size());
+
+    const double x1 = a.x, y1 = a.y;
+    const double dx = b.x-x1, dy = b.y-y1;
+    const double* ax = s.ax.empty() ? 0 : &s.ax[0];
+    const double* ay = s.ay.empty() ? 0 : &s.ay[0];
+    const double* bx = s.bx.empty() ? 0 : &s.bx[0];
+    const double* by = s.by.empty() ? 0 : &s.by[0];
+    int count = 0;
+    int i = first;
+
+#if defined(__AVX__)
+    const __m256d vx1 = _mm256_set1_pd(x1), vy1 = _mm256_set1_pd(y1);
+    const __m256d vdx = _mm256_set1_pd(dx), vdy = _mm256_set1_pd(dy);
+    const __m256d zero = _mm256_setzero_pd(), one = _mm256_set1_pd(1);
+    for (; i+4<=last; i+=4) {
+        __m256d x3 = _mm256_loadu_pd(ax+i), y3 = _mm256_loadu_pd(ay+i);
+        __m256d ex = _mm256_sub_pd(_mm256_loadu_pd(bx+i),x3);
+        __m256d ey = _mm256_sub_pd(_mm256_loadu_pd(by+i),y3);
+        __m256d rx = _mm256_sub_pd(vx1,x3), ry = _mm256_sub_pd(vy1,y3);
+        __m256d denom = _mm256_sub_pd(_mm256_mul_pd(ey,vdx),_mm256_mul_pd(ex,vdy));
+        __m256d u = _mm256_div_pd(_mm256_sub_pd(_mm256_mul_pd(ex,ry),_mm256_mul_pd(ey,rx)),denom);
+        __m256d v = _mm256_div_pd(_mm256_sub_pd(_mm256_mul_pd(vdx,ry),_mm256_mul_pd(vdy,rx)),denom);
+        __m256d m = _mm256_cmp_pd(denom,zero,_CMP_NEQ_OQ);
+        m = _mm256_and_pd(m,_mm256_cmp_pd(u,zero,_CMP_GE_OQ));
+        m = _mm256_and_pd(m,_mm256_cmp_pd(u,one,_CMP_LE_OQ));
+        m = _mm256_and_pd(m,_mm256_cmp_pd(v,zero,_CMP_GE_OQ));
+        m = _mm256_and_pd(m,_mm256_cmp_pd(v,one,_CMP_LE_OQ));
+        _mm256_storeu_pd(&t[i],u);
+        int bits = _mm256_movemask_pd(m);
+        for (int k=0; k<4; ++k) {
+            hit[i+k] = (bits>>k)&1;
+            count += (bits>>k)&1;
+        }
+    }
+#elif defined(INTERSECT_SSE2)
+    const __m128d vx1 = _mm_set1_pd(x1), vy1 = _mm_set1_pd(y1);
+    const __m128d vdx = _mm_set1_pd(dx), vdy = _mm_set1_pd(dy);
+    const __m128d zero = _mm_setzero_pd(), one = _mm_set1_pd(1);
+    for (; i+2<=last; i+=2) {
+        __m128d x3 = _mm_loadu_pd(ax+i), y3 = _mm_loadu_pd(ay+i);
+        __m128d ex = _mm_sub_pd(_mm_loadu_pd(bx+i),x3);
+        __m128d ey = _mm_sub_pd(_mm_loadu_pd(by+i),y3);
+        __m128d rx = _mm_sub_pd(vx1,x3), ry = _mm_sub_pd(vy1,y3);
+        __m128d denom = _mm_sub_pd(_mm_mul_pd(ey,vdx),_mm_mul_pd(ex,vdy));
+        __m128d u = _mm_div_pd(_mm_sub_pd(_mm_mul_pd(ex,ry),_mm_mul_pd(ey,rx)),denom);
+        __m128d v = _mm_div_pd(_mm_sub_pd(_mm_mul_pd(vdx,ry),_mm_mul_pd(vdy,rx)),denom);
+        __m128d m = _mm_cmpneq_pd(denom,zero);
+        m = _mm_and_pd(m,_mm_cmpge_pd(u,zero));
+        m = _mm_and_pd(m,_mm_cmple_pd(u,one));
+        m = _mm_and_pd(m,_mm_cmpge_pd(v,zero));
+        m = _mm_and_pd(m,_mm_cmple_pd(v,one));
+        _mm_storeu_pd(&t[i],u);
+        int bits = _mm_movemask_pd(m);
+        hit[i] = bits&1;
+        hit[i+1] = (bits>>1)&1;
+        count += (bits&1)+((bits>>1)&1);
+    }
+#endif
+
+    for (; i<last; ++i) {    // what is left, or all without SIMD
+        double ex = bx[i]-ax[i], ey = by[i]-ay[i];
+        double rx = x1-ax[i], ry = y1-ay[i];
+        double denom = ey*dx - ex*dy;
+        hit[i] = 0;
+        t[i] = 0;
+        if (denom==0) continue;    // parallel
+        double u = (ex*ry - ey*rx)/denom;
+        double v = (dx*ry - dy*rx)/denom;
+        t[i] = u;
+        if (u<0 || 1<u || v<0 || 1<v) continue;
+        hit[i] = 1;
+        ++count;
+    }
+    return count;
+}
+
+//------------------------------------------------------------------------------
+
+} // of namespace Graph_lib
@@ -0,0 +1,65 @@
+
+//
+// This is a GUI support code to the chapters 12-16 of the book
+// "Programming -- Principles and Practice Using C++" by Bjarne Stroustrup
+//
+
+#ifndef INTERSECT_GUARD
+#define INTERSECT_GUARD 1
+
+#include "Point.h"
+#include "std_lib_facilities.h"
+
+namespace Graph_lib {
+
+//------------------------------------------------------------------------------
+
+// does two lines (p1,p2) and (p3,p4) intersect?
+// if se return the distance of the intersect point as distances from p1
+pair<double,double> line_intersect(Point p1, Point p2, Point p3, Point p4, bool& parallel);
+
+// intersection between two line segments
+bool line_segment_intersect(Point p1, Point p2, Point p3, Point p4, Point& intersection);
+
+//------------------------------------------------------------------------------
+
+// line segments packed for testing many at a time:
+// the coordinates are kept in separate arrays so that they can be loaded
+// into SIMD registers several segments at once
+class Segments {
+public:
+    void add(Point a, Point b);
+    void clear() { ax.clear(); ay.clear(); bx.clear(); by.clear(); }
+    void reserve(int n) { ax.reserve(n); ay.reserve(n); bx.reserve(n); by.reserve(n); }
+
+    int size() const { return int(ax.size()); }
+    Point start(int i) const { return Point(int(ax[i]),int(ay[i])); }
+    Point end(int i) const { return Point(int(bx[i]),int(by[i])); }
+
+private:
+    friend int segment_intersect(Point, Point, const Segments&, int, int,
+                                 vector<char>&, vector<double>&);
+    vector<double> ax, ay, bx, by;
+};
+
+//------------------------------------------------------------------------------
+
+// test segment a-b against segments first to last-1 of s, just as
+// line_segment_intersect(a,b,s.start(i),s.end(i),p) would: hit[i] becomes 1 for
+// a segment that a-b meets and 0 for others; where hit[i] is 1, t[i] tells how
+// far along a-b (0 to 1) they meet. hit and t are grown to s.size() if need be.
+// Uses AVX or SSE2 where the compiler targets them. Returns the number of hits.
+int segment_intersect(Point a, Point b, const Segments& s, int first, int last,
+                      vector<char>& hit, vector<double>& t);
+
+inline int segment_intersect(Point a, Point b, const Segments& s,
+                             vector<char>& hit, vector<double>& t)
+{
+    return segment_intersect(a,b,s,0,s.size(),hit,t);
+}
+
+//------------------------------------------------------------------------------
+
+} // of namespace Graph_lib
+
+#endif // INTERSECT_GUARD
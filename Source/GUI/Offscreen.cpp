@@ -0,0 +1,80 @@
+
+//
+// This is a GUI support code to the chapters 12-16 of the book
+// "Programming -- Principles and Practice Using C++" by Bjarne Stroustrup
+//
+
+#include <FL/Fl.H>
+#include "Offscreen.h"
+#include "Thread_pool.h"
+
+//------------------------------------------------------------------------------
+
+namespace Graph_lib {
+
+//------------------------------------------------------------------------------
+
+Offscreen::Offscreen(int w, int h, int depth)
+    :canvas(w,h,depth), driver(dl), surface(&driver), bg(FL_BACKGROUND_COLOR),
+     pool(&Thread_pool::shared()), tile(64), by_style(false)
+{
+}
+
+//------------------------------------------------------------------------------
+
+void Offscreen::detach(Shape& s)
+{
+    remove_shape(shapes,s);
+}
+
+//------------------------------------------------------------------------------
+
+void Offscreen::put_on_top(Shape& p)
+{
+    raise_shape(shapes,p);
+}
+
+//------------------------------------------------------------------------------
+
+void Offscreen::draw()
+{
+    // first let the shapes draw as usual, but into dl:
+    dl.clear();
+    driver.begin(canvas.width(),canvas.height());
+    Fl_Surface_Device* old = Fl_Surface_Device::surface();
+    surface.set_current();
+    try {
+        draw_all(shapes,by_style);
+    }
+    catch (...) {
+        old->set_current();
+        throw;
+    }
+    old->set_current();
+
+    // then turn dl into pixels:
+    unsigned char r, g, b;
+    Fl::get_color(bg.as_int(),r,g,b);
+    canvas.clear(r,g,b,bg.visibility() ? 255 : 0);
+    if (pool)
+        rasterize(dl,canvas,*pool,tile);
+    else
+        rasterize(dl,canvas);
+}
+
+//------------------------------------------------------------------------------
+
+void Offscreen::write_ppm(const string& file_name) const
+{
+    ofstream os(file_name.c_str(),ios_base::binary);
+    if (!os) error("cannot open \""+file_name+'\"');
+    os << "P6\n" << canvas.width() << ' ' << canvas.height() << "\n255\n";
+    for (int y = 0; y<canvas.height(); ++y)
+        for (int x = 0; x<canvas.width(); ++x)
+            os.write(reinterpret_cast<const char*>(canvas.pixel(x,y)),3);
+    if (!os) error("cannot write \""+file_name+'\"');
+}
+
+//------------------------------------------------------------------------------
+
+} // of namespace Graph_lib
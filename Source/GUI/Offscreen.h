@@ -0,0 +1,65 @@
+
+//
+// This is a GUI support code to the chapters 12-16 of the book
+// "Programming -- Principles and Practice Using C++" by Bjarne Stroustrup
+//
+
+#ifndef OFFSCREEN_GUARD
+#define OFFSCREEN_GUARD 1
+
+#include "Graph.h"
+#include "Raster.h"
+
+namespace Graph_lib {
+
+//------------------------------------------------------------------------------
+
+// Offscreen is a Window without the window: shapes attached to it are
+// drawn into pixels in memory, so no display (X server or otherwise) is needed.
+// Use it to render charts on a server, for tests comparing against stored
+// images, and for profiling Shape::draw_lines().
+class Offscreen {
+public:
+    Offscreen(int w, int h, int depth = 3);    // depth 3 for RGB, 4 for RGBA
+    virtual ~Offscreen() { }
+
+    int x_max() const { return canvas.width(); }
+    int y_max() const { return canvas.height(); }
+
+    void set_color(Color c) { bg = c; }    // background; invisible gives alpha 0
+    Color color() const { return bg; }
+
+    void attach(Shape& s) { shapes.push_back(&s); }
+    void detach(Shape& s);     // remove s from shapes
+    void put_on_top(Shape& p); // put p on top of other shapes
+
+    void draw();               // draw the attached shapes into pixels()
+    void set_draw_by_style(bool b) { by_style = b; }    // see draw_all()
+
+    // draw() rasterizes tiles in parallel on pool (by default the shared one);
+    // 0 means draw on the calling thread only
+    void set_pool(Thread_pool* p, int tile_size = 64) { pool = p; tile = tile_size; }
+
+    const Canvas& pixels() const { return canvas; }
+    void write_ppm(const string& file_name) const;    // binary PPM; alpha is dropped
+
+private:
+    vector<Shape*> shapes;     // shapes attached to the offscreen
+    Canvas canvas;
+    Display_list dl;           // what the shapes drew in the last draw()
+    Soft_driver driver;
+    Soft_surface surface;
+    Color bg;
+    Thread_pool* pool;
+    int tile;
+    bool by_style;
+
+    Offscreen(const Offscreen&);    // prevent copying
+    Offscreen& operator=(const Offscreen&);
+};
+
+//------------------------------------------------------------------------------
+
+} // of namespace Graph_lib
+
+#endif // OFFSCREEN_GUARD
@@ -25,5 +25,60 @@ inline bool operator!=(Point a, Point b) { return !(a==b); }
 
 //------------------------------------------------------------------------------
 
+struct Bounds {    // a box of pixels: (x,y) is the top left corner
+    int x, y, w, h;
+    Bounds(int xx, int yy, int ww, int hh) : x(xx), y(yy), w(ww), h(hh) { }
+    Bounds() :x(0), y(0), w(0), h(0) { }
+
+    bool empty() const { return w<=0 || h<=0; }
+    bool contains(Point p) const { return x<=p.x && p.x<x+w && y<=p.y && p.y<y+h; }
+};
+
+//------------------------------------------------------------------------------
+
+inline bool operator==(Bounds a, Bounds b)
+{
+    return a.x==b.x && a.y==b.y && a.w==b.w && a.h==b.h;
+}
+
+//------------------------------------------------------------------------------
+
+inline bool operator!=(Bounds a, Bounds b) { return !(a==b); }
+
+//------------------------------------------------------------------------------
+
+inline bool intersects(Bounds a, Bounds b)
+{
+    return !a.empty() && !b.empty()
+        && a.x<b.x+b.w && b.x<a.x+a.w && a.y<b.y+b.h && b.y<a.y+a.h;
+}
+
+//------------------------------------------------------------------------------
+
+inline Bounds intersection(Bounds a, Bounds b)    // empty if a and b don't meet
+{
+    int x0 = a.x>b.x ? a.x : b.x;
+    int y0 = a.y>b.y ? a.y : b.y;
+    int x1 = a.x+a.w<b.x+b.w ? a.x+a.w : b.x+b.w;
+    int y1 = a.y+a.h<b.y+b.h ? a.y+a.h : b.y+b.h;
+    if (x1<=x0 || y1<=y0) return Bounds();
+    return Bounds(x0,y0,x1-x0,y1-y0);
+}
+
+//------------------------------------------------------------------------------
+
+inline Bounds unite(Bounds a, Bounds b)    // smallest box holding both a and b
+{
+    if (a.empty()) return b;
+    if (b.empty()) return a;
+    int x0 = a.x<b.x ? a.x : b.x;
+    int y0 = a.y<b.y ? a.y : b.y;
+    int x1 = a.x+a.w>b.x+b.w ? a.x+a.w : b.x+b.w;
+    int y1 = a.y+a.h>b.y+b.h ? a.y+a.h : b.y+b.h;
+    return Bounds(x0,y0,x1-x0,y1-y0);
+}
+
+//------------------------------------------------------------------------------
+
 #endif // POINT_GUARD
 
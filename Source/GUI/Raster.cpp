@@ -0,0 +1,1059 @@
+
+//
+// This is a GUI support code to the chapters 12-16 of the book
+// "Programming -- Principles and Practice Using C++" by Bjarne Stroustrup
+//
+
+#include <algorithm>
+#include <FL/Fl.H>
+#include <FL/Fl_Image.H>
+#include <FL/Fl_Bitmap.H>
+#include <FL/Fl_Pixmap.H>
+#include <FL/fl_draw.H>
+#include "Raster.h"
+#include "Thread_pool.h"
+
+//------------------------------------------------------------------------------
+
+namespace Graph_lib {
+
+//------------------------------------------------------------------------------
+
+Canvas::Canvas(int ww, int hh, int dd) : w(ww), h(hh), d(dd)
+{
+    if (w<=0 || h<=0) error("Bad canvas: non-positive width or height");
+    if (d!=3 && d!=4) error("Bad canvas: depth must be 3 (RGB) or 4 (RGBA)");
+    pix.resize(w*h*d);
+}
+
+//------------------------------------------------------------------------------
+
+void Canvas::clear(unsigned char r, unsigned char g, unsigned char b, unsigned char a)
+{
+    for (unsigned int i = 0; i<pix.size(); i+=d) {
+        pix[i] = r;
+        pix[i+1] = g;
+        pix[i+2] = b;
+        if (d==4) pix[i+3] = a;
+    }
+}
+
+//------------------------------------------------------------------------------
+
+// 5x7 glyphs for the characters ' ' to '~', one byte per column, top row in bit 0
+static const unsigned char glyphs[95][5] = {
+    {0x00,0x00,0x00,0x00,0x00}, {0x00,0x00,0x5F,0x00,0x00}, {0x00,0x07,0x00,0x07,0x00},
+    {0x14,0x7F,0x14,0x7F,0x14}, {0x24,0x2A,0x7F,0x2A,0x12}, {0x23,0x13,0x08,0x64,0x62},
+    {0x36,0x49,0x55,0x22,0x50}, {0x00,0x05,0x03,0x00,0x00}, {0x00,0x1C,0x22,0x41,0x00},
+    {0x00,0x41,0x22,0x1C,0x00}, {0x14,0x08,0x3E,0x08,0x14}, {0x08,0x08,0x3E,0x08,0x08},
+    {0x00,0x50,0x30,0x00,0x00}, {0x08,0x08,0x08,0x08,0x08}, {0x00,0x60,0x60,0x00,0x00},
+    {0x20,0x10,0x08,0x04,0x02}, {0x3E,0x51,0x49,0x45,0x3E}, {0x00,0x42,0x7F,0x40,0x00},
+    {0x42,0x61,0x51,0x49,0x46}, {0x21,0x41,0x45,0x4B,0x31}, {0x18,0x14,0x12,0x7F,0x10},
+    {0x27,0x45,0x45,0x45,0x39}, {0x3C,0x4A,0x49,0x49,0x30}, {0x01,0x71,0x09,0x05,0x03},
+    {0x36,0x49,0x49,0x49,0x36}, {0x06,0x49,0x49,0x29,0x1E}, {0x00,0x36,0x36,0x00,0x00},
+    {0x00,0x56,0x36,0x00,0x00}, {0x08,0x14,0x22,0x41,0x00}, {0x14,0x14,0x14,0x14,0x14},
+    {0x00,0x41,0x22,0x14,0x08}, {0x02,0x01,0x51,0x09,0x06}, {0x32,0x49,0x79,0x41,0x3E},
+    {0x7E,0x11,0x11,0x11,0x7E}, {0x7F,0x49,0x49,0x49,0x36}, {0x3E,0x41,0x41,0x41,0x22},
+    {0x7F,0x41,0x41,0x22,0x1C}, {0x7F,0x49,0x49,0x49,0x41}, {0x7F,0x09,0x09,0x09,0x01},
+    {0x3E,0x41,0x49,0x49,0x7A}, {0x7F,0x08,0x08,0x08,0x7F}, {0x00,0x41,0x7F,0x41,0x00},
+    {0x20,0x40,0x41,0x3F,0x01}, {0x7F,0x08,0x14,0x22,0x41}, {0x7F,0x40,0x40,0x40,0x40},
+    {0x7F,0x02,0x0C,0x02,0x7F}, {0x7F,0x04,0x08,0x10,0x7F}, {0x3E,0x41,0x41,0x41,0x3E},
+    {0x7F,0x09,0x09,0x09,0x06}, {0x3E,0x41,0x51,0x21,0x5E}, {0x7F,0x09,0x19,0x29,0x46},
+    {0x46,0x49,0x49,0x49,0x31}, {0x01,0x01,0x7F,0x01,0x01}, {0x3F,0x40,0x40,0x40,0x3F},
+    {0x1F,0x20,0x40,0x20,0x1F}, {0x3F,0x40,0x38,0x40,0x3F}, {0x63,0x14,0x08,0x14,0x63},
+    {0x07,0x08,0x70,0x08,0x07}, {0x61,0x51,0x49,0x45,0x43}, {0x00,0x7F,0x41,0x41,0x00},
+    {0x02,0x04,0x08,0x10,0x20}, {0x00,0x41,0x41,0x7F,0x00}, {0x04,0x02,0x01,0x02,0x04},
+    {0x40,0x40,0x40,0x40,0x40}, {0x00,0x01,0x02,0x04,0x00}, {0x20,0x54,0x54,0x54,0x78},
+    {0x7F,0x48,0x44,0x44,0x38}, {0x38,0x44,0x44,0x44,0x20}, {0x38,0x44,0x44,0x48,0x7F},
+    {0x38,0x54,0x54,0x54,0x18}, {0x08,0x7E,0x09,0x01,0x02}, {0x0C,0x52,0x52,0x52,0x3E},
+    {0x7F,0x08,0x04,0x04,0x78}, {0x00,0x44,0x7D,0x40,0x00}, {0x20,0x40,0x44,0x3D,0x00},
+    {0x7F,0x10,0x28,0x44,0x00}, {0x00,0x41,0x7F,0x40,0x00}, {0x7C,0x04,0x18,0x04,0x78},
+    {0x7C,0x08,0x04,0x04,0x78}, {0x38,0x44,0x44,0x44,0x38}, {0x7C,0x14,0x14,0x14,0x08},
+    {0x08,0x14,0x14,0x18,0x7C}, {0x7C,0x08,0x04,0x04,0x08}, {0x48,0x54,0x54,0x54,0x20},
+    {0x04,0x3F,0x44,0x40,0x20}, {0x3C,0x40,0x40,0x20,0x7C}, {0x1C,0x20,0x40,0x20,0x1C},
+    {0x3C,0x40,0x30,0x40,0x3C}, {0x44,0x28,0x10,0x28,0x44}, {0x0C,0x50,0x50,0x50,0x3C},
+    {0x44,0x64,0x54,0x4C,0x44}, {0x00,0x08,0x36,0x41,0x00}, {0x00,0x00,0x7F,0x00,0x00},
+    {0x00,0x41,0x36,0x08,0x00}, {0x08,0x04,0x08,0x10,0x08}
+};
+
+static const int glyph_advance = 6;    // in font pixels, including the gap
+static const int glyph_height = 7;
+
+//------------------------------------------------------------------------------
+
+inline void put(Canvas& c, int x, int y, const Raster_op& op)
+{
+    unsigned char* p = c.pixel(x,y);
+    p[0] = op.r;
+    p[1] = op.g;
+    p[2] = op.b;
+    if (c.depth()==4) p[3] = 255;
+}
+
+//------------------------------------------------------------------------------
+
+inline void blend(Canvas& c, int x, int y, int r, int g, int b, int a)
+{
+    unsigned char* p = c.pixel(x,y);
+    if (a==255) {
+        p[0] = r;
+        p[1] = g;
+        p[2] = b;
+        if (c.depth()==4) p[3] = 255;
+        return;
+    }
+    p[0] = (r*a + p[0]*(255-a))/255;
+    p[1] = (g*a + p[1]*(255-a))/255;
+    p[2] = (b*a + p[2]*(255-a))/255;
+    if (c.depth()==4) p[3] = a + p[3]*(255-a)/255;
+}
+
+//------------------------------------------------------------------------------
+
+// one pixel per step along the major axis; the minor coordinate of a step
+// is computed directly, so we can start at the first step inside r
+static void raster_line(const Raster_op& op, Canvas& c, Bounds r)
+{
+    long long dx = op.x1-op.x0;
+    long long dy = op.y1-op.y0;
+    long long adx = dx<0 ? -dx : dx;
+    long long ady = dy<0 ? -dy : dy;
+
+    if (adx==0 && ady==0) {
+        if (r.contains(Point(op.x0,op.y0))) put(c,op.x0,op.y0,op);
+        return;
+    }
+
+    if (ady<=adx) {
+        int lo = max(min(op.x0,op.x1),r.x);
+        int hi = min(max(op.x0,op.x1),r.x+r.w-1);
+        for (int x = lo; x<=hi; ++x) {
+            long long t = x<op.x0 ? op.x0-x : x-op.x0;
+            long long s = (2*t*ady+adx)/(2*adx);
+            int y = int(dy<0 ? op.y0-s : op.y0+s);
+            if (r.y<=y && y<r.y+r.h) put(c,x,y,op);
+        }
+    }
+    else {
+        int lo = max(min(op.y0,op.y1),r.y);
+        int hi = min(max(op.y0,op.y1),r.y+r.h-1);
+        for (int y = lo; y<=hi; ++y) {
+            long long t = y<op.y0 ? op.y0-y : y-op.y0;
+            long long s = (2*t*adx+ady)/(2*ady);
+            int x = int(dx<0 ? op.x0-s : op.x0+s);
+            if (r.x<=x && x<r.x+r.w) put(c,x,y,op);
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+
+static void raster_rect(const Raster_op& op, Canvas& c, Bounds r)
+{
+    for (int y = r.y; y<r.y+r.h; ++y)
+        for (int x = r.x; x<r.x+r.w; ++x)
+            put(c,x,y,op);
+}
+
+//------------------------------------------------------------------------------
+
+// even-odd fill, sampling at pixel centers like the X server does
+static void raster_polygon(const Display_list& dl, const Raster_op& op, Canvas& c, Bounds r,
+                           vector<double>& xs)
+{
+    const Raster_edge* e = &dl.edges[op.first];
+    for (int y = r.y; y<r.y+r.h; ++y) {
+        double yc = y+0.5;
+        xs.clear();
+        for (int i = 0; i<op.count; ++i)
+            if ((e[i].y0<=yc && yc<e[i].y1) || (e[i].y1<=yc && yc<e[i].y0))
+                xs.push_back(e[i].x0+(yc-e[i].y0)*(e[i].x1-e[i].x0)/(e[i].y1-e[i].y0));
+        sort(xs.begin(),xs.end());
+        for (unsigned int i = 1; i<xs.size(); i+=2) {
+            int lo = max(int(ceil(xs[i-1]-0.5)),r.x);
+            int hi = min(int(ceil(xs[i]-0.5)),r.x+r.w);
+            for (int x = lo; x<hi; ++x) put(c,x,y,op);
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+
+static void raster_text(const Display_list& dl, const Raster_op& op, Canvas& c, Bounds r)
+{
+    int s = op.x1;
+    int top = op.y0-glyph_height*s;
+    for (int i = 0; i<op.count; ++i) {
+        unsigned char ch = dl.chars[op.first+i];
+        if (ch<' ' || '~'<ch) ch = '?';
+        int left = op.x0+i*glyph_advance*s;
+        if (left+5*s<=r.x || r.x+r.w<=left) continue;
+        for (int col = 0; col<5; ++col)
+            for (int row = 0; row<glyph_height; ++row) {
+                if (!(glyphs[ch-' '][col]>>row & 1)) continue;
+                Bounds dot = intersection(Bounds(left+col*s,top+row*s,s,s),r);
+                for (int y = dot.y; y<dot.y+dot.h; ++y)
+                    for (int x = dot.x; x<dot.x+dot.w; ++x)
+                        put(c,x,y,op);
+            }
+    }
+}
+
+//------------------------------------------------------------------------------
+
+static void raster_image(const Display_list& dl, const Raster_op& op, Canvas& c, Bounds r)
+{
+    const unsigned char* data = op.data ? op.data : &dl.bytes[op.first];
+    for (int y = r.y; y<r.y+r.h; ++y) {
+        const unsigned char* p = data+(y-op.y0)*op.ld+(r.x-op.x0)*op.dd;
+        for (int x = r.x; x<r.x+r.w; ++x, p+=op.dd)
+            switch (op.dd) {
+            case 1: blend(c,x,y,p[0],p[0],p[0],255);   break;
+            case 2: blend(c,x,y,p[0],p[0],p[0],p[1]);  break;
+            case 3: blend(c,x,y,p[0],p[1],p[2],255);   break;
+            default: blend(c,x,y,p[0],p[1],p[2],p[3]); break;
+            }
+    }
+}
+
+//------------------------------------------------------------------------------
+
+static void raster_bitmap(const Raster_op& op, Canvas& c, Bounds r)
+{
+    for (int y = r.y; y<r.y+r.h; ++y) {
+        const unsigned char* row = op.data+(y-op.y0)*op.ld;
+        for (int x = r.x; x<r.x+r.w; ++x) {
+            int bit = x-op.x0;
+            if (row[bit>>3]>>(bit&7) & 1) put(c,x,y,op);
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+
+// draw the part of op that lies in area
+static void raster(const Display_list& dl, const Raster_op& op, Canvas& c, Bounds area,
+                   vector<double>& scratch)
+{
+    Bounds r = intersection(op.box,area);
+    if (r.empty()) return;
+
+    switch (op.kind) {
+    case Raster_op::line:         raster_line(op,c,r);              break;
+    case Raster_op::fill_rect:    raster_rect(op,c,r);              break;
+    case Raster_op::fill_polygon: raster_polygon(dl,op,c,r,scratch); break;
+    case Raster_op::text:         raster_text(dl,op,c,r);           break;
+    case Raster_op::image:        raster_image(dl,op,c,r);          break;
+    case Raster_op::bitmap:       raster_bitmap(op,c,r);            break;
+    }
+}
+
+//------------------------------------------------------------------------------
+
+void rasterize(const Display_list& dl, Canvas& c)
+{
+    Bounds all(0,0,c.width(),c.height());
+    vector<double> scratch;
+    for (unsigned int i = 0; i<dl.ops.size(); ++i)
+        raster(dl,dl.ops[i],c,all,scratch);
+}
+
+//------------------------------------------------------------------------------
+
+void rasterize(const Display_list& dl, Canvas& c, Thread_pool& pool, int tile)
+{
+    if (tile<=0) error("non-positive raster tile size");
+    int nx = (c.width()+tile-1)/tile;
+    int ny = (c.height()+tile-1)/tile;
+
+    // bin: the ops touching each tile, in drawing order
+    vector<vector<int> > bins(nx*ny);
+    for (unsigned int i = 0; i<dl.ops.size(); ++i) {
+        Bounds b = intersection(dl.ops[i].box,Bounds(0,0,c.width(),c.height()));
+        if (b.empty()) continue;
+        for (int ty = b.y/tile; ty<=(b.y+b.h-1)/tile; ++ty)
+            for (int tx = b.x/tile; tx<=(b.x+b.w-1)/tile; ++tx)
+                bins[ty*nx+tx].push_back(i);
+    }
+
+    // tiles don't share pixels, so they can be drawn in any order
+    pool.for_each(nx*ny,[&](int t) {
+        Bounds area = intersection(Bounds(t%nx*tile,t/nx*tile,tile,tile),
+                                   Bounds(0,0,c.width(),c.height()));
+        vector<double> scratch;
+        const vector<int>& bin = bins[t];
+        for (unsigned int i = 0; i<bin.size(); ++i)
+            raster(dl,dl.ops[bin[i]],c,area,scratch);
+    });
+}
+
+//------------------------------------------------------------------------------
+
+const char* Soft_driver::class_id = "Soft_driver";
+
+//------------------------------------------------------------------------------
+
+void Soft_driver::begin(int ww, int hh)
+{
+    frame = Bounds(0,0,ww,hh);
+    clips.assign(1,frame);
+    lstyle = 0;
+    lwidth = 0;
+    mode = none;
+    vs.clear();
+    starts.assign(1,0);
+    color(FL_FOREGROUND_COLOR);
+    font(FL_HELVETICA,FL_NORMAL_SIZE);
+}
+
+//------------------------------------------------------------------------------
+
+void Soft_driver::color(Fl_Color c)
+{
+    Fl_Graphics_Driver::color(c);    // so that fl_color() reports it
+    Fl::get_color(c,cr,cg,cb);
+}
+
+//------------------------------------------------------------------------------
+
+void Soft_driver::color(uchar r, uchar g, uchar b)
+{
+    Fl_Graphics_Driver::color(fl_rgb_color(r,g,b));
+    cr = r;
+    cg = g;
+    cb = b;
+}
+
+//------------------------------------------------------------------------------
+
+void Soft_driver::font(Fl_Font face, Fl_Fontsize fsize)
+{
+    Fl_Graphics_Driver::font(face,fsize);
+}
+
+//------------------------------------------------------------------------------
+
+int Soft_driver::scale()    // font pixel size for the current font size
+{
+    int s = (size()+4)/9;
+    return s<1 ? 1 : s;
+}
+
+//------------------------------------------------------------------------------
+
+double Soft_driver::width(const char*, int n)
+{
+    return n*glyph_advance*scale();
+}
+
+//------------------------------------------------------------------------------
+
+double Soft_driver::width(unsigned int)
+{
+    return glyph_advance*scale();
+}
+
+//------------------------------------------------------------------------------
+
+void Soft_driver::text_extents(const char*, int n, int& dx, int& dy, int& w, int& h)
+{
+    int s = scale();
+    dx = 0;
+    dy = -glyph_height*s;
+    w = n ? (n*glyph_advance-1)*s : 0;
+    h = glyph_height*s;
+}
+
+//------------------------------------------------------------------------------
+
+int Soft_driver::height()
+{
+    return (glyph_height+2)*scale();
+}
+
+//------------------------------------------------------------------------------
+
+int Soft_driver::descent()
+{
+    return 2*scale();
+}
+
+//------------------------------------------------------------------------------
+
+Raster_op Soft_driver::make(Raster_op::Kind k, Bounds b) const
+{
+    Raster_op op = Raster_op();
+    op.kind = k;
+    op.r = cr;
+    op.g = cg;
+    op.b = cb;
+    op.clip = clips.back();
+    op.box = intersection(b,op.clip);
+    return op;
+}
+
+//------------------------------------------------------------------------------
+
+void Soft_driver::emit(const Raster_op& op)
+{
+    if (!op.box.empty()) out.ops.push_back(op);
+}
+
+//------------------------------------------------------------------------------
+
+void Soft_driver::emit_segment(double x0, double y0, double x1, double y1)
+{
+    if (lwidth<=1) {    // a plain one pixel line
+        int ax = int(floor(x0+0.5));
+        int ay = int(floor(y0+0.5));
+        int bx = int(floor(x1+0.5));
+        int by = int(floor(y1+0.5));
+        Raster_op op = make(Raster_op::line,
+            Bounds(min(ax,bx),min(ay,by),abs(bx-ax)+1,abs(by-ay)+1));
+        op.x0 = ax;
+        op.y0 = ay;
+        op.x1 = bx;
+        op.y1 = by;
+        emit(op);
+        return;
+    }
+
+    // a wide line is a filled rectangle around the centers of its end pixels
+    double len = sqrt((x1-x0)*(x1-x0)+(y1-y0)*(y1-y0));
+    double ux = len ? (x1-x0)/len : 1;
+    double uy = len ? (y1-y0)/len : 0;
+    double hw = lwidth/2.0;
+    double nx = -uy*hw;
+    double ny = ux*hw;
+    if (len==0) {    // a dot: a square centered on the pixel
+        x0 -= hw;
+        x1 += hw;
+    }
+    vector<Vertex> v(4);
+    v[0].x = x0+0.5+nx; v[0].y = y0+0.5+ny;
+    v[1].x = x1+0.5+nx; v[1].y = y1+0.5+ny;
+    v[2].x = x1+0.5-nx; v[2].y = y1+0.5-ny;
+    v[3].x = x0+0.5-nx; v[3].y = y0+0.5-ny;
+    emit_polygon(v,vector<int>(1,0));
+}
+
+//------------------------------------------------------------------------------
+
+void Soft_driver::emit_line(double x0, double y0, double x1, double y1)
+{
+    static const int dash[] = { 3, 1 };
+    static const int dot[] = { 1, 1 };
+    static const int dashdot[] = { 3, 1, 1, 1 };
+    static const int dashdotdot[] = { 3, 1, 1, 1, 1, 1 };
+
+    const int* pattern = 0;
+    int n = 0;
+    switch (lstyle) {
+    case FL_DASH:       pattern = dash;       n = 2; break;
+    case FL_DOT:        pattern = dot;        n = 2; break;
+    case FL_DASHDOT:    pattern = dashdot;    n = 4; break;
+    case FL_DASHDOTDOT: pattern = dashdotdot; n = 6; break;
+    }
+
+    double len = sqrt((x1-x0)*(x1-x0)+(y1-y0)*(y1-y0));
+    if (!pattern || len==0) {
+        emit_segment(x0,y0,x1,y1);
+        return;
+    }
+
+    // walk along the line, drawing the "on" parts of the pattern
+    int unit = lwidth>1 ? lwidth : 1;
+    double thin = lwidth>1 ? 0 : 1;    // a thin dash includes its last pixel
+    double t = 0;
+    for (int i = 0; t<len; i = (i+1)%n) {
+        double t2 = t+pattern[i]*unit;
+        if (i%2==0) {
+            double e = min(t2-thin,len);
+            if (e<t) e = t;
+            emit_segment(x0+(x1-x0)*t/len,y0+(y1-y0)*t/len,
+                         x0+(x1-x0)*e/len,y0+(y1-y0)*e/len);
+        }
+        t = t2;
+    }
+}
+
+//------------------------------------------------------------------------------
+
+void Soft_driver::emit_polyline(const Vertex* v, int n, bool close)
+{
+    for (int i = 1; i<n; ++i)
+        emit_line(v[i-1].x,v[i-1].y,v[i].x,v[i].y);
+    if (close && 2<n) emit_line(v[n-1].x,v[n-1].y,v[0].x,v[0].y);
+}
+
+//------------------------------------------------------------------------------
+
+void Soft_driver::emit_polygon(const vector<Vertex>& v, const vector<int>& st)
+{
+    if (v.empty()) return;
+    double x0 = v[0].x, y0 = v[0].y, x1 = x0, y1 = y0;
+    for (unsigned int i = 1; i<v.size(); ++i) {
+        x0 = min(x0,v[i].x);
+        y0 = min(y0,v[i].y);
+        x1 = max(x1,v[i].x);
+        y1 = max(y1,v[i].y);
+    }
+    int bx = int(floor(x0));
+    int by = int(floor(y0));
+    Raster_op op = make(Raster_op::fill_polygon,
+        Bounds(bx,by,int(ceil(x1))-bx+1,int(ceil(y1))-by+1));
+    if (op.box.empty()) return;
+
+    op.first = int(out.edges.size());
+    for (unsigned int c = 0; c<st.size(); ++c) {    // each contour is closed
+        int s = st[c];
+        int e = c+1<st.size() ? st[c+1] : int(v.size());
+        for (int i = s; i<e; ++i) {
+            const Vertex& a = v[i];
+            const Vertex& b = v[i+1<e ? i+1 : s];
+            if (a.y==b.y) continue;    // horizontal edges never cross a scan line
+            Raster_edge edge = { a.x, a.y, b.x, b.y };
+            out.edges.push_back(edge);
+        }
+    }
+    op.count = int(out.edges.size())-op.first;
+    if (op.count) emit(op);
+}
+
+//------------------------------------------------------------------------------
+
+// points along the ellipse inside the box (x,y,w,h) from angle a1 to a2,
+// counterclockwise in degrees from 3 o'clock, a vertex every two pixels or so
+void Soft_driver::ellipse(vector<Vertex>& v, double x, double y, double w, double h,
+                          double a1, double a2) const
+{
+    const double pi = 3.14159265358979323846;
+    double rx = w/2;
+    double ry = h/2;
+    double sweep = a2-a1;
+    int n = int(fabs(sweep)/360*(rx+ry)*1.6)+2;
+    if (n<int(fabs(sweep)/45)+2) n = int(fabs(sweep)/45)+2;
+    if (1024<n) n = 1024;
+    for (int i = 0; i<=n; ++i) {
+        double a = (a1+sweep*i/n)*pi/180;
+        Vertex p = { x+rx+rx*cos(a), y+ry-ry*sin(a) };
+        v.push_back(p);
+    }
+}
+
+//------------------------------------------------------------------------------
+
+unsigned char* Soft_driver::copy_image(int X, int Y, int W, int H, int d, Bounds& b)
+// make room for the visible part of a transient image and return where it goes
+{
+    b = intersection(Bounds(X,Y,W,H),clips.back());
+    if (b.empty()) return 0;
+    int first = int(out.bytes.size());
+    out.bytes.resize(first+b.w*b.h*d);
+    Raster_op op = make(Raster_op::image,b);
+    op.x0 = b.x;
+    op.y0 = b.y;
+    op.first = first;
+    op.count = b.w*b.h*d;
+    op.data = 0;
+    op.dw = b.w;
+    op.dh = b.h;
+    op.dd = d;
+    op.ld = b.w*d;
+    emit(op);
+    return &out.bytes[first];
+}
+
+//------------------------------------------------------------------------------
+
+void Soft_driver::emit_image(Raster_op::Kind k, const uchar* data, int w, int h, int d, int ld,
+                             int X, int Y, int W, int H, int cx, int cy)
+// draw the W*H part of data with pixel (cx,cy) at (X,Y)
+{
+    Raster_op op = make(k,intersection(Bounds(X,Y,W,H),Bounds(X-cx,Y-cy,w,h)));
+    op.x0 = X-cx;
+    op.y0 = Y-cy;
+    op.data = data;
+    op.dw = w;
+    op.dh = h;
+    op.dd = d;
+    op.ld = ld;
+    emit(op);
+}
+
+//------------------------------------------------------------------------------
+
+void Soft_driver::rect(int x, int y, int w, int h)
+{
+    if (w<=0 || h<=0) return;
+    if (w==1 || h==1) {
+        rectf(x,y,w,h);
+        return;
+    }
+    emit_line(x,y,x+w-1,y);
+    emit_line(x+w-1,y,x+w-1,y+h-1);
+    emit_line(x+w-1,y+h-1,x,y+h-1);
+    emit_line(x,y+h-1,x,y);
+}
+
+//------------------------------------------------------------------------------
+
+void Soft_driver::rectf(int x, int y, int w, int h)
+{
+    if (w<=0 || h<=0) return;
+    emit(make(Raster_op::fill_rect,Bounds(x,y,w,h)));
+}
+
+//------------------------------------------------------------------------------
+
+void Soft_driver::line_style(int style, int width, char*)
+{
+    lstyle = style & 0xff;    // cap and join bits make no difference here
+    lwidth = width;
+}
+
+//------------------------------------------------------------------------------
+
+void Soft_driver::xyline(int x, int y, int x1)
+{
+    emit_line(x,y,x1,y);
+}
+
+//------------------------------------------------------------------------------
+
+void Soft_driver::xyline(int x, int y, int x1, int y2)
+{
+    emit_line(x,y,x1,y);
+    emit_line(x1,y,x1,y2);
+}
+
+//------------------------------------------------------------------------------
+
+void Soft_driver::xyline(int x, int y, int x1, int y2, int x3)
+{
+    emit_line(x,y,x1,y);
+    emit_line(x1,y,x1,y2);
+    emit_line(x1,y2,x3,y2);
+}
+
+//------------------------------------------------------------------------------
+
+void Soft_driver::yxline(int x, int y, int y1)
+{
+    emit_line(x,y,x,y1);
+}
+
+//------------------------------------------------------------------------------
+
+void Soft_driver::yxline(int x, int y, int y1, int x2)
+{
+    emit_line(x,y,x,y1);
+    emit_line(x,y1,x2,y1);
+}
+
+//------------------------------------------------------------------------------
+
+void Soft_driver::yxline(int x, int y, int y1, int x2, int y3)
+{
+    emit_line(x,y,x,y1);
+    emit_line(x,y1,x2,y1);
+    emit_line(x2,y1,x2,y3);
+}
+
+//------------------------------------------------------------------------------
+
+void Soft_driver::line(int x, int y, int x1, int y1)
+{
+    emit_line(x,y,x1,y1);
+}
+
+//------------------------------------------------------------------------------
+
+void Soft_driver::line(int x, int y, int x1, int y1, int x2, int y2)
+{
+    emit_line(x,y,x1,y1);
+    emit_line(x1,y1,x2,y2);
+}
+
+//------------------------------------------------------------------------------
+
+void Soft_driver::draw(const char* str, int n, int x, int y)
+{
+    if (n<=0) return;
+    int s = scale();
+    Raster_op op = make(Raster_op::text,
+        Bounds(x,y-glyph_height*s,n*glyph_advance*s,glyph_height*s));
+    if (op.box.empty()) return;
+    op.x0 = x;
+    op.y0 = y;
+    op.x1 = s;
+    op.first = int(out.chars.size());
+    op.count = n;
+    out.chars.append(str,n);
+    emit(op);
+}
+
+//------------------------------------------------------------------------------
+
+void Soft_driver::draw(int, const char* str, int n, int x, int y)
+{
+    draw(str,n,x,y);    // the built-in font is not rotated
+}
+
+//------------------------------------------------------------------------------
+
+void Soft_driver::rtl_draw(const char* str, int n, int x, int y)
+{
+    draw(str,n,x-int(width(str,n)),y);
+}
+
+//------------------------------------------------------------------------------
+
+void Soft_driver::point(int x, int y)
+{
+    rectf(x,y,1,1);
+}
+
+//------------------------------------------------------------------------------
+
+void Soft_driver::loop(int x0, int y0, int x1, int y1, int x2, int y2)
+{
+    Vertex v[] = { {double(x0),double(y0)}, {double(x1),double(y1)}, {double(x2),double(y2)} };
+    emit_polyline(v,3,true);
+}
+
+//------------------------------------------------------------------------------
+
+void Soft_driver::loop(int x0, int y0, int x1, int y1, int x2, int y2, int x3, int y3)
+{
+    Vertex v[] = { {double(x0),double(y0)}, {double(x1),double(y1)},
+                   {double(x2),double(y2)}, {double(x3),double(y3)} };
+    emit_polyline(v,4,true);
+}
+
+//------------------------------------------------------------------------------
+
+void Soft_driver::polygon(int x0, int y0, int x1, int y1, int x2, int y2)
+{
+    Vertex v[] = { {double(x0),double(y0)}, {double(x1),double(y1)}, {double(x2),double(y2)} };
+    emit_polygon(vector<Vertex>(v,v+3),vector<int>(1,0));
+}
+
+//------------------------------------------------------------------------------
+
+void Soft_driver::polygon(int x0, int y0, int x1, int y1, int x2, int y2, int x3, int y3)
+{
+    Vertex v[] = { {double(x0),double(y0)}, {double(x1),double(y1)},
+                   {double(x2),double(y2)}, {double(x3),double(y3)} };
+    emit_polygon(vector<Vertex>(v,v+4),vector<int>(1,0));
+}
+
+//------------------------------------------------------------------------------
+
+void Soft_driver::begin_points()
+{
+    mode = points;
+    vs.clear();
+    starts.assign(1,0);
+}
+
+//------------------------------------------------------------------------------
+
+void Soft_driver::begin_line()
+{
+    mode = polyline;
+    vs.clear();
+    starts.assign(1,0);
+}
+
+//------------------------------------------------------------------------------
+
+void Soft_driver::begin_loop()
+{
+    mode = closed;
+    vs.clear();
+    starts.assign(1,0);
+}
+
+//------------------------------------------------------------------------------
+
+void Soft_driver::begin_polygon()
+{
+    mode = filled;
+    vs.clear();
+    starts.assign(1,0);
+}
+
+//------------------------------------------------------------------------------
+
+void Soft_driver::begin_complex_polygon()
+{
+    mode = complex;
+    vs.clear();
+    starts.assign(1,0);
+}
+
+//------------------------------------------------------------------------------
+
+void Soft_driver::vertex(double x, double y)
+{
+    transformed_vertex(transform_x(x,y),transform_y(x,y));
+}
+
+//------------------------------------------------------------------------------
+
+void Soft_driver::transformed_vertex(double xf, double yf)
+{
+    if (int(vs.size())>starts.back() && vs.back().x==xf && vs.back().y==yf) return;
+    Vertex v = { xf, yf };
+    vs.push_back(v);
+}
+
+//------------------------------------------------------------------------------
+
+void Soft_driver::circle(double x, double y, double r)
+// like FLTK, a circle is the only thing in its path
+{
+    double cx = transform_x(x,y);
+    double cy = transform_y(x,y);
+    double dx = transform_dx(r,0);
+    double dy = transform_dy(r,0);
+    double rr = sqrt(dx*dx+dy*dy);
+
+    vector<Vertex> v;
+    ellipse(v,cx-rr,cy-rr,rr+rr,rr+rr,0,360);
+    if (mode==filled || mode==complex)
+        emit_polygon(v,vector<int>(1,0));
+    else
+        emit_polyline(&v[0],int(v.size()),false);
+}
+
+//------------------------------------------------------------------------------
+
+void Soft_driver::arc(int x, int y, int w, int h, double a1, double a2)
+{
+    if (w<=0 || h<=0) return;
+    vector<Vertex> v;
+    ellipse(v,x,y,w,h,a1,a2);
+    emit_polyline(&v[0],int(v.size()),false);
+}
+
+//------------------------------------------------------------------------------
+
+void Soft_driver::pie(int x, int y, int w, int h, double a1, double a2)
+{
+    if (w<=0 || h<=0) return;
+    vector<Vertex> v;
+    if (fabs(a2-a1)<360) {    // a slice starts at the center
+        Vertex c = { x+w/2.0, y+h/2.0 };
+        v.push_back(c);
+    }
+    ellipse(v,x,y,w,h,a1,a2);
+    emit_polygon(v,vector<int>(1,0));
+}
+
+//------------------------------------------------------------------------------
+
+void Soft_driver::end_points()
+{
+    for (unsigned int i = 0; i<vs.size(); ++i)
+        rectf(int(floor(vs[i].x+0.5)),int(floor(vs[i].y+0.5)),1,1);
+    mode = none;
+}
+
+//------------------------------------------------------------------------------
+
+void Soft_driver::end_line()
+{
+    if (vs.size()==1)
+        rectf(int(floor(vs[0].x+0.5)),int(floor(vs[0].y+0.5)),1,1);
+    else if (1<vs.size())
+        emit_polyline(&vs[0],int(vs.size()),false);
+    mode = none;
+}
+
+//------------------------------------------------------------------------------
+
+void Soft_driver::end_loop()
+{
+    if (!vs.empty()) emit_polyline(&vs[0],int(vs.size()),true);
+    mode = none;
+}
+
+//------------------------------------------------------------------------------
+
+void Soft_driver::end_polygon()
+{
+    if (2<vs.size()) emit_polygon(vs,vector<int>(1,0));
+    mode = none;
+}
+
+//------------------------------------------------------------------------------
+
+void Soft_driver::gap()    // end a contour of a complex polygon
+{
+    if (int(vs.size())-starts.back()<3)
+        vs.resize(starts.back());    // too small to enclose anything
+    else
+        starts.push_back(int(vs.size()));
+}
+
+//------------------------------------------------------------------------------
+
+void Soft_driver::end_complex_polygon()
+{
+    gap();
+    if (starts.back()==int(vs.size())) starts.pop_back();
+    if (!starts.empty()) emit_polygon(vs,starts);
+    mode = none;
+}
+
+//------------------------------------------------------------------------------
+
+void Soft_driver::push_clip(int x, int y, int w, int h)
+{
+    Bounds b;
+    if (0<w && 0<h) b = intersection(Bounds(x,y,w,h),clips.back());
+    clips.push_back(b);
+}
+
+//------------------------------------------------------------------------------
+
+int Soft_driver::clip_box(int x, int y, int w, int h, int& X, int& Y, int& W, int& H)
+{
+    Bounds b = intersection(Bounds(x,y,w,h),clips.back());
+    X = b.x;
+    Y = b.y;
+    W = b.w;
+    H = b.h;
+    return b!=Bounds(x,y,w,h);
+}
+
+//------------------------------------------------------------------------------
+
+int Soft_driver::not_clipped(int x, int y, int w, int h)
+{
+    return intersects(Bounds(x,y,w,h),clips.back());
+}
+
+//------------------------------------------------------------------------------
+
+void Soft_driver::push_no_clip()
+{
+    clips.push_back(frame);
+}
+
+//------------------------------------------------------------------------------
+
+void Soft_driver::pop_clip()
+{
+    if (1<clips.size()) clips.pop_back();
+}
+
+//------------------------------------------------------------------------------
+
+void Soft_driver::draw_image(const uchar* buf, int X, int Y, int W, int H, int D, int L)
+{
+    if (D<0) D = -D;    // right to left images are drawn left to right
+    if (D==0) return;
+    if (L==0) L = W*D;
+    int d = D<3 ? 1 : 3;
+    Bounds b;
+    unsigned char* p = copy_image(X,Y,W,H,d,b);
+    if (!p) return;
+    for (int y = b.y; y<b.y+b.h; ++y) {
+        const uchar* s = buf+(y-Y)*L+(b.x-X)*D;
+        for (int x = 0; x<b.w; ++x, s+=D)
+            for (int i = 0; i<d; ++i) *p++ = s[i];
+    }
+}
+
+//------------------------------------------------------------------------------
+
+void Soft_driver::draw_image_mono(const uchar* buf, int X, int Y, int W, int H, int D, int L)
+{
+    if (D<0) D = -D;
+    if (D==0) return;
+    if (L==0) L = W*D;
+    Bounds b;
+    unsigned char* p = copy_image(X,Y,W,H,1,b);
+    if (!p) return;
+    for (int y = b.y; y<b.y+b.h; ++y) {
+        const uchar* s = buf+(y-Y)*L+(b.x-X)*D;
+        for (int x = 0; x<b.w; ++x, s+=D) *p++ = *s;
+    }
+}
+
+//------------------------------------------------------------------------------
+
+void Soft_driver::draw_image(Fl_Draw_Image_Cb cb, void* data, int X, int Y, int W, int H, int D)
+{
+    if (D<=0) return;
+    int d = D<3 ? 1 : 3;
+    Bounds b;
+    unsigned char* p = copy_image(X,Y,W,H,d,b);
+    if (!p) return;
+    vector<uchar> line(b.w*D);
+    for (int y = b.y; y<b.y+b.h; ++y) {
+        cb(data,b.x-X,y-Y,b.w,&line[0]);
+        const uchar* s = &line[0];
+        for (int x = 0; x<b.w; ++x, s+=D)
+            for (int i = 0; i<d; ++i) *p++ = s[i];
+    }
+}
+
+//------------------------------------------------------------------------------
+
+void Soft_driver::draw_image_mono(Fl_Draw_Image_Cb cb, void* data, int X, int Y, int W, int H, int D)
+{
+    if (D<=0) return;
+    Bounds b;
+    unsigned char* p = copy_image(X,Y,W,H,1,b);
+    if (!p) return;
+    vector<uchar> line(b.w*D);
+    for (int y = b.y; y<b.y+b.h; ++y) {
+        cb(data,b.x-X,y-Y,b.w,&line[0]);
+        const uchar* s = &line[0];
+        for (int x = 0; x<b.w; ++x, s+=D) *p++ = *s;
+    }
+}
+
+//------------------------------------------------------------------------------
+
+void Soft_driver::draw(Fl_RGB_Image* rgb, int XP, int YP, int WP, int HP, int cx, int cy)
+// the image's pixels live as long as the image, so they are not copied
+{
+    if (!rgb->array || rgb->d()<1 || 4<rgb->d()) return;
+    int ld = rgb->ld() ? rgb->ld() : rgb->w()*rgb->d();
+    emit_image(Raster_op::image,rgb->array,rgb->w(),rgb->h(),rgb->d(),ld,XP,YP,WP,HP,cx,cy);
+}
+
+//------------------------------------------------------------------------------
+
+void Soft_driver::draw(Fl_Bitmap* bm, int XP, int YP, int WP, int HP, int cx, int cy)
+{
+    if (!bm->array) return;
+    emit_image(Raster_op::bitmap,bm->array,bm->w(),bm->h(),1,(bm->w()+7)/8,XP,YP,WP,HP,cx,cy);
+}
+
+//------------------------------------------------------------------------------
+
+void Soft_driver::draw(Fl_Pixmap* pxm, int XP, int YP, int WP, int HP, int cx, int cy)
+// a pixmap's pixels are XPM text, so they are turned into RGBA and copied
+{
+    Fl_RGB_Image rgb(pxm);    // transparent where the pixmap is
+    if (!rgb.array || rgb.d()!=4) return;
+    Bounds v = intersection(Bounds(XP,YP,WP,HP),Bounds(XP-cx,YP-cy,rgb.w(),rgb.h()));
+    Bounds b;
+    unsigned char* p = copy_image(v.x,v.y,v.w,v.h,4,b);
+    if (!p) return;
+    int ld = rgb.ld() ? rgb.ld() : rgb.w()*4;
+    for (int y = b.y; y<b.y+b.h; ++y) {
+        const uchar* s = rgb.array+(y-YP+cy)*ld+(b.x-XP+cx)*4;
+        for (int i = 0; i<b.w*4; ++i) *p++ = s[i];
+    }
+}
+
+//------------------------------------------------------------------------------
+
+} // of namespace Graph_lib
@@ -0,0 +1,203 @@
+
+//
+// This is a GUI support code to the chapters 12-16 of the book
+// "Programming -- Principles and Practice Using C++" by Bjarne Stroustrup
+//
+
+#ifndef RASTER_GUARD
+#define RASTER_GUARD 1
+
+#include <FL/Fl_Device.H>
+#include "Point.h"
+#include "std_lib_facilities.h"
+
+namespace Graph_lib {
+
+//------------------------------------------------------------------------------
+
+// Canvas is a block of pixels in memory, rows from top to bottom.
+// Each pixel is depth() bytes: RGB for depth 3, RGBA for depth 4.
+class Canvas {
+public:
+    Canvas(int ww, int hh, int dd = 3);
+
+    int width() const { return w; }
+    int height() const { return h; }
+    int depth() const { return d; }
+
+    unsigned char* data() { return &pix[0]; }
+    const unsigned char* data() const { return &pix[0]; }
+    unsigned char* pixel(int x, int y) { return &pix[(y*w+x)*d]; }
+    const unsigned char* pixel(int x, int y) const { return &pix[(y*w+x)*d]; }
+
+    void clear(unsigned char r, unsigned char g, unsigned char b, unsigned char a = 255);
+private:
+    int w, h, d;
+    vector<unsigned char> pix;
+};
+
+//------------------------------------------------------------------------------
+
+// one primitive recorded by a Soft_driver; everything the FLTK drawing
+// functions can do is reduced to these few kinds
+struct Raster_op {
+    enum Kind { line, fill_rect, fill_polygon, text, image, bitmap };
+
+    Kind kind;
+    unsigned char r, g, b;    // color
+    Bounds clip;              // clip box in effect when the op was recorded
+    Bounds box;               // pixels the op may touch (inside clip)
+
+    int x0, y0, x1, y1;       // line: end points; text: origin and scale in x1;
+                              // image, bitmap: where data pixel (0,0) goes
+    int first, count;         // range of edges (fill_polygon), chars (text) or bytes (image)
+
+    const unsigned char* data;    // image or bitmap pixels; 0 if copied to Display_list::bytes
+    int dw, dh, dd, ld;       // their width, height, depth and bytes per row
+};
+
+//------------------------------------------------------------------------------
+
+struct Raster_edge { double x0, y0, x1, y1; };
+
+//------------------------------------------------------------------------------
+
+struct Display_list {    // everything drawn in one frame, in drawing order
+    vector<Raster_op> ops;
+    vector<Raster_edge> edges;    // polygon outlines
+    string chars;                 // text
+    vector<unsigned char> bytes;  // copies of transient image data
+
+    void clear() { ops.clear(); edges.clear(); chars.clear(); bytes.clear(); }
+};
+
+//------------------------------------------------------------------------------
+
+class Thread_pool;
+
+void rasterize(const Display_list& dl, Canvas& c);    // draw dl onto c
+
+// draw dl onto c a tile*tile square of pixels at a time, the tiles in parallel
+// on pool; each op is binned to the tiles its box touches and each tile draws
+// its ops in order, so the result is exactly that of rasterize(dl,c)
+void rasterize(const Display_list& dl, Canvas& c, Thread_pool& pool, int tile = 64);
+
+//------------------------------------------------------------------------------
+
+// Soft_driver is an FLTK graphics driver that needs no display:
+// the fl_line(), fl_rectf(), fl_pie(), fl_draw(), ... calls made while
+// it is current are recorded into a Display_list for rasterize().
+// Text is drawn in a small built-in fixed-width font.
+class Soft_driver : public Fl_Graphics_Driver {
+public:
+    static const char* class_id;
+    const char* class_name() { return class_id; }
+
+    using Fl_Graphics_Driver::color;
+    using Fl_Graphics_Driver::font;
+
+    Soft_driver(Display_list& dl)
+        : out(dl), cr(0), cg(0), cb(0), lstyle(0), lwidth(0), mode(none) { }
+
+    void begin(int ww, int hh);    // start a frame of ww*hh pixels
+
+    void color(Fl_Color c);
+    void color(uchar r, uchar g, uchar b);
+    void font(Fl_Font face, Fl_Fontsize fsize);
+    double width(const char* str, int n);
+    double width(unsigned int c);
+    void text_extents(const char* str, int n, int& dx, int& dy, int& w, int& h);
+    int height();
+    int descent();
+
+protected:
+    void rect(int x, int y, int w, int h);
+    void rectf(int x, int y, int w, int h);
+    void line_style(int style, int width=0, char* dashes=0);
+    void xyline(int x, int y, int x1);
+    void xyline(int x, int y, int x1, int y2);
+    void xyline(int x, int y, int x1, int y2, int x3);
+    void yxline(int x, int y, int y1);
+    void yxline(int x, int y, int y1, int x2);
+    void yxline(int x, int y, int y1, int x2, int y3);
+    void line(int x, int y, int x1, int y1);
+    void line(int x, int y, int x1, int y1, int x2, int y2);
+    void draw(const char* str, int n, int x, int y);
+    void draw(int angle, const char* str, int n, int x, int y);
+    void rtl_draw(const char* str, int n, int x, int y);
+    void point(int x, int y);
+    void loop(int x0, int y0, int x1, int y1, int x2, int y2);
+    void loop(int x0, int y0, int x1, int y1, int x2, int y2, int x3, int y3);
+    void polygon(int x0, int y0, int x1, int y1, int x2, int y2);
+    void polygon(int x0, int y0, int x1, int y1, int x2, int y2, int x3, int y3);
+    void begin_points();
+    void begin_line();
+    void begin_loop();
+    void begin_polygon();
+    void vertex(double x, double y);
+    void circle(double x, double y, double r);
+    void arc(int x, int y, int w, int h, double a1, double a2);
+    void pie(int x, int y, int w, int h, double a1, double a2);
+    void end_points();
+    void end_line();
+    void end_loop();
+    void end_polygon();
+    void begin_complex_polygon();
+    void gap();
+    void end_complex_polygon();
+    void transformed_vertex(double xf, double yf);
+    void push_clip(int x, int y, int w, int h);
+    int clip_box(int x, int y, int w, int h, int& X, int& Y, int& W, int& H);
+    int not_clipped(int x, int y, int w, int h);
+    void push_no_clip();
+    void pop_clip();
+
+    void draw_image(const uchar* buf, int X, int Y, int W, int H, int D=3, int L=0);
+    void draw_image_mono(const uchar* buf, int X, int Y, int W, int H, int D=1, int L=0);
+    void draw_image(Fl_Draw_Image_Cb cb, void* data, int X, int Y, int W, int H, int D=3);
+    void draw_image_mono(Fl_Draw_Image_Cb cb, void* data, int X, int Y, int W, int H, int D=1);
+    void draw(Fl_RGB_Image* rgb, int XP, int YP, int WP, int HP, int cx, int cy);
+    void draw(Fl_Bitmap* bm, int XP, int YP, int WP, int HP, int cx, int cy);
+    void draw(Fl_Pixmap* pxm, int XP, int YP, int WP, int HP, int cx, int cy);
+
+private:
+    enum Mode { none, points, polyline, closed, filled, complex };
+    struct Vertex { double x, y; };
+
+    Display_list& out;
+    Bounds frame;               // the whole canvas
+    vector<Bounds> clips;       // clip stack; clips.back() is in effect
+    unsigned char cr, cg, cb;   // current color
+    int lstyle, lwidth;         // current line style
+
+    Mode mode;
+    vector<Vertex> vs;          // vertices of the current path
+    vector<int> starts;         // first vertex of each contour in vs
+
+    Raster_op make(Raster_op::Kind k, Bounds b) const;
+    void emit(const Raster_op& op);
+    void emit_line(double x0, double y0, double x1, double y1);
+    void emit_segment(double x0, double y0, double x1, double y1);
+    void emit_polyline(const Vertex* v, int n, bool close);
+    void emit_polygon(const vector<Vertex>& v, const vector<int>& starts);
+    void emit_image(Raster_op::Kind k, const uchar* data, int w, int h, int d, int ld,
+                    int X, int Y, int W, int H, int cx, int cy);
+    unsigned char* copy_image(int X, int Y, int W, int H, int d, Bounds& b);
+    void ellipse(vector<Vertex>& v, double x, double y, double w, double h,
+                 double a1, double a2) const;
+    int scale();
+};
+
+//------------------------------------------------------------------------------
+
+// the surface to make current so that drawing goes to a Soft_driver
+class Soft_surface : public Fl_Surface_Device {
+public:
+    Soft_surface(Soft_driver* d) : Fl_Surface_Device(d) { }
+};
+
+//------------------------------------------------------------------------------
+
+} // of namespace Graph_lib
+
+#endif // RASTER_GUARD
@@ -0,0 +1,191 @@
+
+//
+// This is a GUI support code to the chapters 12-16 of the book
+// "Programming -- Principles and Practice Using C++" by Bjarne Stroustrup
+//
+
+#include <algorithm>
+#include "Shape_index.h"
+
+//------------------------------------------------------------------------------
+
+namespace Graph_lib {
+
+namespace {
+
+const long long max_cells = 256;    // a shape touching more cells goes on the big list
+
+inline unsigned long long key(int cx, int cy)    // shifted unsigned: cx may be negative
+{
+    return (static_cast<unsigned long long>(static_cast<unsigned int>(cx))<<32)
+        | static_cast<unsigned int>(cy);
+}
+
+} // of anonymous namespace
+
+//------------------------------------------------------------------------------
+
+Shape_index::Shape_index(int cell)
+    : cs(cell), top(0)
+{
+    if (cs<=0) cs = 64;
+}
+
+//------------------------------------------------------------------------------
+
+int Shape_index::cell_of(int v) const    // round down, also for negative v
+{
+    return 0<=v ? v/cs : -((-v-1)/cs)-1;
+}
+
+//------------------------------------------------------------------------------
+
+void Shape_index::place(Entry& e)
+{
+    e.big = false;
+    if (e.box.empty()) return;    // nothing to find
+    int cx0 = cell_of(e.box.x), cx1 = cell_of(e.box.x+e.box.w-1);
+    int cy0 = cell_of(e.box.y), cy1 = cell_of(e.box.y+e.box.h-1);
+    if (max_cells<(long long)(cx1-cx0+1)*(cy1-cy0+1)) {
+        e.big = true;
+        big.push_back(&e);
+        return;
+    }
+    for (int cy=cy0; cy<=cy1; ++cy)
+        for (int cx=cx0; cx<=cx1; ++cx)
+            cells[key(cx,cy)].push_back(&e);
+}
+
+//------------------------------------------------------------------------------
+
+void Shape_index::unplace(Entry& e)
+{
+    if (e.big) {
+        big.erase(std::find(big.begin(),big.end(),&e));
+        return;
+    }
+    if (e.box.empty()) return;
+    int cx0 = cell_of(e.box.x), cx1 = cell_of(e.box.x+e.box.w-1);
+    int cy0 = cell_of(e.box.y), cy1 = cell_of(e.box.y+e.box.h-1);
+    for (int cy=cy0; cy<=cy1; ++cy)
+        for (int cx=cx0; cx<=cx1; ++cx) {
+            std::unordered_map<unsigned long long,Cell>::iterator p = cells.find(key(cx,cy));
+            Cell& c = p->second;
+            Cell::iterator q = std::find(c.begin(),c.end(),&e);
+            *q = c.back();    // order within a cell doesn't matter
+            c.pop_back();
+            if (c.empty()) cells.erase(p);
+        }
+}
+
+//------------------------------------------------------------------------------
+
+void Shape_index::insert(Shape* s, Bounds b)
+{
+    std::unordered_map<Shape*,Entry>::iterator p = entries.find(s);
+    if (p!=entries.end()) {
+        update(s,b);
+        raise(s);
+        return;
+    }
+    Entry& e = entries[s];
+    e.s = s;
+    e.box = b;
+    e.z = top++;
+    place(e);
+}
+
+//------------------------------------------------------------------------------
+
+void Shape_index::update(Shape* s, Bounds b)
+{
+    std::unordered_map<Shape*,Entry>::iterator p = entries.find(s);
+    if (p==entries.end() || p->second.box==b) return;
+    unplace(p->second);
+    p->second.box = b;
+    place(p->second);
+}
+
+//------------------------------------------------------------------------------
+
+void Shape_index::raise(Shape* s)
+{
+    std::unordered_map<Shape*,Entry>::iterator p = entries.find(s);
+    if (p!=entries.end()) p->second.z = top++;
+}
+
+//------------------------------------------------------------------------------
+
+void Shape_index::erase(Shape* s)
+{
+    std::unordered_map<Shape*,Entry>::iterator p = entries.find(s);
+    if (p==entries.end()) return;
+    unplace(p->second);
+    entries.erase(p);
+}
+
+//------------------------------------------------------------------------------
+
+void Shape_index::scan(int cx, int cy, const Cell& c, Bounds b, std::vector<Hit>& hits) const
+// a shape in several cells is reported only from the cell
+// holding the top left corner of its overlap with b
+{
+    for (unsigned int i=0; i<c.size(); ++i) {
+        const Entry& e = *c[i];
+        if (!intersects(e.box,b)) continue;
+        if (cell_of(std::max(e.box.x,b.x))!=cx) continue;
+        if (cell_of(std::max(e.box.y,b.y))!=cy) continue;
+        Hit h = { e.z, e.s };
+        hits.push_back(h);
+    }
+}
+
+//------------------------------------------------------------------------------
+
+std::vector<Shape*> Shape_index::in(Bounds b) const
+{
+    std::vector<Shape*> res;
+    if (b.empty()) return res;
+
+    std::vector<Hit> hits;
+    for (unsigned int i=0; i<big.size(); ++i)
+        if (intersects(big[i]->box,b)) {
+            Hit h = { big[i]->z, big[i]->s };
+            hits.push_back(h);
+        }
+
+    int cx0 = cell_of(b.x), cx1 = cell_of(b.x+b.w-1);
+    int cy0 = cell_of(b.y), cy1 = cell_of(b.y+b.h-1);
+
+    if ((long long)(cx1-cx0+1)*(cy1-cy0+1)<=(long long)cells.size()) {
+        for (int cy=cy0; cy<=cy1; ++cy)
+            for (int cx=cx0; cx<=cx1; ++cx) {
+                std::unordered_map<unsigned long long,Cell>::const_iterator p = cells.find(key(cx,cy));
+                if (p!=cells.end()) scan(cx,cy,p->second,b,hits);
+            }
+    }
+    else {    // b covers more cells than are in use: look at those in use
+        for (std::unordered_map<unsigned long long,Cell>::const_iterator p = cells.begin(); p!=cells.end(); ++p) {
+            int cx = int(static_cast<unsigned int>(p->first>>32));
+            int cy = int(static_cast<unsigned int>(p->first));
+            if (cx<cx0 || cx1<cx || cy<cy0 || cy1<cy) continue;
+            scan(cx,cy,p->second,b,hits);
+        }
+    }
+
+    std::sort(hits.begin(),hits.end());
+    res.reserve(hits.size());
+    for (unsigned int i=0; i<hits.size(); ++i) res.push_back(hits[i].s);
+    return res;
+}
+
+//------------------------------------------------------------------------------
+
+std::vector<Shape*> Shape_index::at(Point p) const
+{
+    return in(Bounds(p.x,p.y,1,1));
+}
+
+//------------------------------------------------------------------------------
+
+} // of namespace Graph_lib
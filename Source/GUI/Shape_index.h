@@ -0,0 +1,69 @@
+
+//
+// This is a GUI support code to the chapters 12-16 of the book
+// "Programming -- Principles and Practice Using C++" by Bjarne Stroustrup
+//
+
+#ifndef SHAPE_INDEX_GUARD
+#define SHAPE_INDEX_GUARD 1
+
+#include <vector>
+#include <unordered_map>
+#include "Point.h"
+
+namespace Graph_lib
+{
+    class Shape;
+
+//------------------------------------------------------------------------------
+
+    // Shape_index finds the shapes whose boxes meet a given box or point
+    // without looking at every shape: the plane is cut into cell*cell squares
+    // and each shape is listed in the squares its box touches.
+    // Shapes covering very many squares are kept on a separate list.
+    // Answers come in drawing order: bottom first, top last.
+    class Shape_index {
+    public:
+        explicit Shape_index(int cell = 64);
+
+        void insert(Shape* s, Bounds b);   // add s on top, or move it to the top
+        void update(Shape* s, Bounds b);   // s is now in b; its place in the order is kept
+        void raise(Shape* s);              // put s on top of the others
+        void erase(Shape* s);
+
+        std::vector<Shape*> in(Bounds b) const;    // shapes whose boxes meet b
+        std::vector<Shape*> at(Point p) const;     // shapes whose boxes hold p
+
+        int size() const { return int(entries.size()); }
+
+    private:
+        struct Entry {
+            Shape* s;
+            Bounds box;
+            unsigned long z;     // higher is drawn later
+            bool big;            // on the big list rather than in cells
+        };
+        typedef std::vector<Entry*> Cell;
+        struct Hit {
+            unsigned long z;
+            Shape* s;
+            bool operator<(const Hit& h) const { return z<h.z; }
+        };
+
+        int cs;                                       // cell size in pixels
+        unsigned long top;                            // next z to hand out
+        std::unordered_map<Shape*,Entry> entries;     // nodes don't move, so cells can point to them
+        std::unordered_map<unsigned long long,Cell> cells;
+        std::vector<Entry*> big;
+
+        int cell_of(int v) const;    // the cell row or column holding pixel v
+        void place(Entry& e);
+        void unplace(Entry& e);
+        void scan(int cx, int cy, const Cell& c, Bounds b, std::vector<Hit>& hits) const;
+    };
+
+//------------------------------------------------------------------------------
+
+} // of namespace Graph_lib
+
+#endif // SHAPE_INDEX_GUARD
@@ -0,0 +1,128 @@
+
+//
+// This is a GUI support code to the chapters 12-16 of the book
+// "Programming -- Principles and Practice Using C++" by Bjarne Stroustrup
+//
+
+#include <atomic>
+#include <exception>
+#include <memory>
+#include "Thread_pool.h"
+
+//------------------------------------------------------------------------------
+
+namespace Graph_lib {
+
+//------------------------------------------------------------------------------
+
+Thread_pool::Thread_pool(int n) : done(false)
+{
+    if (n<=0) n = int(std::thread::hardware_concurrency());
+    if (n<=0) n = 1;
+    for (int i = 0; i<n; ++i)
+        workers.push_back(std::thread(&Thread_pool::work,this));
+}
+
+//------------------------------------------------------------------------------
+
+Thread_pool::~Thread_pool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m);
+        done = true;
+    }
+    cv.notify_all();
+    for (unsigned int i = 0; i<workers.size(); ++i) workers[i].join();
+}
+
+//------------------------------------------------------------------------------
+
+void Thread_pool::work()
+{
+    for (;;) {
+        std::function<void()> job;
+        {
+            std::unique_lock<std::mutex> lock(m);
+            while (!done && jobs.empty()) cv.wait(lock);
+            if (jobs.empty()) return;    // done, and nothing left to do
+            job = jobs.front();
+            jobs.pop_front();
+        }
+        job();
+    }
+}
+
+//------------------------------------------------------------------------------
+
+void Thread_pool::run(const std::function<void()>& job)
+{
+    {
+        std::lock_guard<std::mutex> lock(m);
+        jobs.push_back(job);
+    }
+    cv.notify_one();
+}
+
+//------------------------------------------------------------------------------
+
+namespace {
+
+struct For_each {    // shared by the threads of one Thread_pool::for_each()
+    For_each(int nn, const std::function<void(int)>& ff) : n(nn), f(ff), next(0), left(nn) { }
+
+    int n;
+    std::function<void(int)> f;
+    std::atomic<int> next;    // next index to hand out
+    std::atomic<int> left;    // indices not yet finished
+    std::mutex m;
+    std::condition_variable cv;
+    std::exception_ptr error;
+
+    void work()    // take indices until there are none left
+    {
+        for (int i; (i = next++)<n; ) {
+            try {
+                f(i);
+            }
+            catch (...) {
+                std::lock_guard<std::mutex> lock(m);
+                if (!error) error = std::current_exception();
+            }
+            if (--left==0) {
+                std::lock_guard<std::mutex> lock(m);
+                cv.notify_all();
+            }
+        }
+    }
+};
+
+}
+
+//------------------------------------------------------------------------------
+
+void Thread_pool::for_each(int n, const std::function<void(int)>& f)
+{
+    if (n<=0) return;
+    // the workers may get to their job after we are gone, so they share it:
+    std::shared_ptr<For_each> fe = std::make_shared<For_each>(n,f);
+    int helpers = n-1<size() ? n-1 : size();
+    for (int i = 0; i<helpers; ++i)
+        run([fe] { fe->work(); });
+    fe->work();
+
+    std::unique_lock<std::mutex> lock(fe->m);
+    while (fe->left!=0) fe->cv.wait(lock);
+    if (fe->error) std::rethrow_exception(fe->error);
+}
+
+//------------------------------------------------------------------------------
+
+Thread_pool& Thread_pool::shared()
+{
+    static Thread_pool pool;
+    return pool;
+}
+
+//------------------------------------------------------------------------------
+
+} // of namespace Graph_lib
@@ -0,0 +1,55 @@
+
+//
+// This is a GUI support code to the chapters 12-16 of the book
+// "Programming -- Principles and Practice Using C++" by Bjarne Stroustrup
+//
+
+#ifndef THREAD_POOL_GUARD
+#define THREAD_POOL_GUARD 1
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Graph_lib {
+
+//------------------------------------------------------------------------------
+
+// a fixed set of worker threads for work that has nothing to do with FLTK:
+// FLTK itself must only be called from the GUI thread
+class Thread_pool {
+public:
+    explicit Thread_pool(int n = 0);    // n workers; 0 for one per core
+    ~Thread_pool();
+
+    int size() const { return int(workers.size()); }
+
+    void run(const std::function<void()>& job);    // run job on some worker, later
+
+    // call f(0), f(1), ... f(n-1) on the workers and the calling thread;
+    // return when all are done, rethrowing the first exception thrown by f
+    void for_each(int n, const std::function<void(int)>& f);
+
+    static Thread_pool& shared();    // one per core, for everybody to use
+
+private:
+    std::vector<std::thread> workers;
+    std::deque<std::function<void()> > jobs;
+    std::mutex m;
+    std::condition_variable cv;
+    bool done;
+
+    void work();
+
+    Thread_pool(const Thread_pool&);    // prevent copying
+    Thread_pool& operator=(const Thread_pool&);
+};
+
+//------------------------------------------------------------------------------
+
+} // of namespace Graph_lib
+
+#endif // THREAD_POOL_GUARD
@@ -28,8 +28,17 @@ Window::Window(Point xy, int ww, int hh, const string& title)
 
 //------------------------------------------------------------------------------
 
+Window::~Window()
+{
+    for (unsigned int i=0; i<shapes.size(); ++i)
+        if (shapes[i]->own==this) shapes[i]->own = 0;
+}
+
+//------------------------------------------------------------------------------
+
 void Window::init()
 {
+    by_style = false;
     resizable(this);
     show();
 }
@@ -39,7 +48,28 @@ void Window::init()
 void Window::draw()
 {
     Fl_Window::draw();
-    for (unsigned int i=0; i<shapes.size(); ++i) shapes[i]->draw();
+    // FLTK has clipped to the damaged area; shapes wholly outside it needn't be drawn
+    int X, Y, W, H;
+    fl_clip_box(0,0,Fl_Window::w(),Fl_Window::h(),X,Y,W,H);
+    draw_all(index.in(Bounds(X,Y,W,H)),by_style);
+}
+
+//------------------------------------------------------------------------------
+
+void Window::damage_area(Bounds b)
+{
+    if (!b.empty()) damage(FL_DAMAGE_EXPOSE,b.x,b.y,b.w,b.h);
+}
+
+//------------------------------------------------------------------------------
+
+void Window::attach(Shape& s)
+{
+    shapes.push_back(&s);
+    s.own = this;
+    s.shown = s.bbox();
+    index.insert(&s,s.shown);
+    damage_area(s.shown);
 }
 
 //------------------------------------------------------------------------------
@@ -61,24 +91,48 @@ void Window::detach(Widget& b)
 //------------------------------------------------------------------------------
 
 void Window::detach(Shape& s)
-    // guess that the last attached will be first released
 {
-    for (unsigned int i = shapes.size(); 0<i; --i)    
-        if (shapes[i-1]==&s)
-            shapes.erase(shapes.begin()+(i-1));
+    remove_shape(shapes,s);
+    index.erase(&s);
+    if (s.own==this) {
+        damage_area(s.shown);
+        s.own = 0;
+    }
+}
+
+//------------------------------------------------------------------------------
+
+void Window::put_on_top(Shape& p)
+{
+    if (!raise_shape(shapes,p)) return;
+    index.raise(&p);
+    damage_area(p.shown);
 }
 
 //------------------------------------------------------------------------------
 
-void Window::put_on_top(Shape& p) {
-    for (int i=0; i<shapes.size(); ++i) {
-        if (&p==shapes[i]) {
-            for (++i; i<shapes.size(); ++i)
-                shapes[i-1] = shapes[i];
-            shapes[shapes.size()-1] = &p;
-            return;
-        }
+void Window::changed(Shape& s)
+{
+    Bounds b = s.bbox();
+    if (b==s.shown) {
+        damage_area(b);    // same place, new look
+        return;
+    }
+    damage_area(s.shown);
+    damage_area(b);
+    s.shown = b;
+    index.update(&s,b);
+}
+
+//------------------------------------------------------------------------------
+
+void Window::changed(Shape& s, Bounds part)
+{
+    if (s.bbox()!=s.shown) {    // it moved after all
+        changed(s);
+        return;
     }
+    damage_area(intersection(part,s.shown));
 }
 
 //------------------------------------------------------------------------------
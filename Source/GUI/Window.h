@@ -12,6 +12,7 @@
 #include <FL/Fl.H>
 #include <FL/Fl_Window.H>
 #include "Point.h"
+#include "Shape_index.h"
 
 using std::string;
 using std::vector;
@@ -30,7 +31,7 @@ namespace Graph_lib
         // top left corner in xy
         Window(Point xy, int w, int h, const string& title);    
 
-        virtual ~Window() { }
+        virtual ~Window();
 
         int x_max() const { return w; }
         int y_max() const { return h; }
@@ -39,7 +40,7 @@ namespace Graph_lib
 
         void set_label(const string& s) { copy_label(s.c_str()); }
 
-        void attach(Shape& s) { shapes.push_back(&s); }
+        void attach(Shape& s);
         void attach(Widget&);
 
         void detach(Shape& s);     // remove s from shapes 
@@ -47,14 +48,26 @@ namespace Graph_lib
 
         void put_on_top(Shape& p); // put p on top of other shapes
 
+        void changed(Shape& s);    // s has moved or changed its look: repaint where it was and is
+        void changed(Shape& s, Bounds part);    // s is where it was, but part of it looks different
+
+        void set_draw_by_style(bool b) { by_style = b; }    // see draw_all()
+
+        // shapes whose bbox() meets b, or holds p, bottom first:
+        vector<Shape*> shapes_in(Bounds b) const { return index.in(b); }
+        vector<Shape*> shapes_at(Point p) const { return index.at(p); }
+
     protected:
         void draw();
 
     private:
         vector<Shape*> shapes;     // shapes attached to window
+        Shape_index index;         // where the shapes are, for drawing and picking
         int w,h;                   // window size
+        bool by_style;             // let draw_all() reorder shapes that don't overlap
 
         void init();
+        void damage_area(Bounds b);    // b needs repainting
     };
 
 //------------------------------------------------------------------------------
@@ -9,15 +9,14 @@ int main() {
 		Graph_lib::Window window{ { x_max() / 3, 200 }, 800, 600, "window" };
 		window.color(39);
 
-		Vector_ref<Graph_lib::Rectangle>v;
+		Rectangle_grid grid;
 		for (int x = 0; x < 16; ++x) {
 			for (int y = 0; y < 16; ++y) {
-				v.push_back(new Graph_lib::Rectangle{{x * 20, y * 20 }, 20, 20});
-				v[v.size() - 1].set_fill_color(x * 16 + y);
-				v[v.size() - 1].set_color(Color::invisible);
-				window.attach(v[v.size() - 1]);
+				grid.add({x * 20, y * 20 }, 20, 20, x * 16 + y);
 			}
 		}
+		grid.set_color(Color::invisible);
+		window.attach(grid);
 		Graph_lib::gui_main();
 	}
 	